@@ -0,0 +1,44 @@
+#include "city_table.h"
+
+static uint16_t read_u16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static int32_t read_i32(const uint8_t *p) {
+  return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+bool city_table_lookup(uint16_t id, City *city) {
+  ResHandle handle = resource_get_handle(RESOURCE_ID_CITY_TABLE);
+  uint8_t header[CITY_HEADER_SIZE];
+  if (!handle || resource_load_byte_range(handle, 0, header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  int count = read_u16(header);
+  int record_size = read_u16(header + 2);
+  // newer tables may append fields; the ones we know come first.
+  if (record_size < CITY_RECORD_SIZE ||
+      resource_size(handle) < CITY_HEADER_SIZE + (size_t)count * record_size) {
+    return false;
+  }
+
+  int lo = 0, hi = count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    uint8_t record[CITY_RECORD_SIZE];
+    resource_load_byte_range(handle, CITY_HEADER_SIZE + mid * record_size, record, sizeof(record));
+    uint16_t mid_id = read_u16(record);
+    if (mid_id < id) {
+      lo = mid + 1;
+    } else if (mid_id > id) {
+      hi = mid - 1;
+    } else {
+      city->id = id;
+      city->latitude_e6 = read_i32(record + 2);
+      city->longitude_e6 = read_i32(record + 6);
+      city->utc_offset = (int16_t)read_u16(record + 10);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * The cities offered for manual location, compiled by tools/make_cities.py
+ * from tools/cities.txt into the CITY_TABLE resource:
+ *
+ *   uint16 count, uint16 record size, then `count' records sorted by id:
+ *   uint16 id, int32 latitude and longitude in micro-degrees, int16
+ *   standard UTC offset in minutes; all little-endian.
+ *
+ * A lookup is a binary search that reads one record per step, so nothing
+ * is kept in RAM.
+ */
+#define CITY_HEADER_SIZE 4
+#define CITY_RECORD_SIZE 12
+// "use the phone's location"
+#define CITY_NONE 0
+
+typedef struct {
+  uint16_t id;
+  int32_t latitude_e6;
+  int32_t longitude_e6;
+  int16_t utc_offset;      // minutes, without DST
+} City;
+
+// fills in `city' and returns true if `id' is in the table.
+bool city_table_lookup(uint16_t id, City *city);
@@ -0,0 +1,32 @@
+/*
+ * Dial geometry, evaluated by the compiler from the constants in
+ * dial_layout.h so that no trig is needed at run time.
+ */
+#include "dial_layout.h"
+
+#define S15 0.25881904510252076
+#define S30 0.5
+#define S45 0.70710678118654752
+#define S60 0.86602540378443865
+#define S75 0.96592582628906829
+
+// rounds to the nearest pixel; every coordinate on the screen is positive.
+#define DIAL_POINT(r, c, s) { (int16_t)(DIAL_CENTER_X + (r) * (c) + 0.5), \
+                              (int16_t)(DIAL_CENTER_Y + (r) * (s) + 0.5) }
+
+// (cos, sin) of each 15 degree step around the unit circle.
+#define DIAL_FOR_EACH_STEP(P, r) \
+  P(r,    1,    0), P(r,  S75,  S15), P(r,  S60,  S30), P(r,  S45,  S45), \
+  P(r,  S30,  S60), P(r,  S15,  S75), P(r,    0,    1), P(r, -S15,  S75), \
+  P(r, -S30,  S60), P(r, -S45,  S45), P(r, -S60,  S30), P(r, -S75,  S15), \
+  P(r,   -1,    0), P(r, -S75, -S15), P(r, -S60, -S30), P(r, -S45, -S45), \
+  P(r, -S30, -S60), P(r, -S15, -S75), P(r,    0,   -1), P(r,  S15, -S75), \
+  P(r,  S30, -S60), P(r,  S45, -S45), P(r,  S60, -S30), P(r,  S75, -S15)
+
+const GPoint dial_mark_points[DIAL_STEPS] = {
+  DIAL_FOR_EACH_STEP(DIAL_POINT, DIAL_MARK_RADIUS)
+};
+
+const GPoint dial_numeral_points[DIAL_STEPS] = {
+  DIAL_FOR_EACH_STEP(DIAL_POINT, DIAL_NUMERAL_RADIUS)
+};
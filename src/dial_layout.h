@@ -0,0 +1,30 @@
+#pragma once
+#include <pebble.h>
+
+// every position on the dial is derived from these; edit them and rebuild
+// to move things around.
+#define DIAL_CENTER_X 72
+#define DIAL_CENTER_Y 84
+#define DIAL_MARK_RADIUS 60
+#define DIAL_NUMERAL_RADIUS 48
+#define DIAL_MOON_CENTER_Y 108
+#define DIAL_MOON_RADIUS 15
+
+#define DIAL_CENTER GPoint(DIAL_CENTER_X, DIAL_CENTER_Y)
+
+// the part of the screen inside the bezel, where the sunlight wedge, the
+// moon and the hands are painted. Layers covering it use DIAL_INTERIOR_CENTER
+// as their local centre.
+#define DIAL_INTERIOR_RADIUS 66
+#define DIAL_INTERIOR_FRAME GRect(DIAL_CENTER_X - DIAL_INTERIOR_RADIUS, \
+                                  DIAL_CENTER_Y - DIAL_INTERIOR_RADIUS, \
+                                  2 * DIAL_INTERIOR_RADIUS + 1, \
+                                  2 * DIAL_INTERIOR_RADIUS + 1)
+#define DIAL_INTERIOR_CENTER GPoint(DIAL_INTERIOR_RADIUS, DIAL_INTERIOR_RADIUS)
+
+// one step per hour of the 24-hour dial (15 degrees), starting at the
+// 3 o'clock position and running clockwise.
+#define DIAL_STEPS 24
+
+extern const GPoint dial_mark_points[DIAL_STEPS];
+extern const GPoint dial_numeral_points[DIAL_STEPS];
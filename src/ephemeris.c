@@ -0,0 +1,205 @@
+#include "ephemeris.h"
+#include "my_math.h"
+#include "suncalc.h"
+#include "sun_table.h"
+
+Ephemeris ephemeris = { .valid = false };
+
+// everything up to the spans fits in one persist record (256 bytes); the
+// spans don't.
+#define EPHEMERIS_PERSIST_SIZE offsetof(Ephemeris, night)
+// bump this whenever a field before the spans changes, even if the size
+// stays the same. Records from before it was kept start with `valid',
+// which reads as layout 1.
+#define EPHEMERIS_LAYOUT 2
+
+static float to_dial_hours(float ut, float utc_offset)
+{
+  float time = ut + 12 + utc_offset;
+  if (time > 24) time -= 24;
+  if (time < 0) time += 24;
+  return time;
+}
+
+static GPoint wedge_point(float dial_hours)
+{
+  int32_t angle = (int32_t)(dial_hours * (MY_TRIG_MAX_ANGLE / 24.0f));
+  return GPoint((int16_t)(my_sin_lookup(angle) * EPHEMERIS_WEDGE_RADIUS / MY_TRIG_ONE),
+		-(int16_t)(my_cos_lookup(angle) * EPHEMERIS_WEDGE_RADIUS / MY_TRIG_ONE));
+}
+
+// floor(a / b) for b > 0.
+static int floor_div(int a, int b)
+{
+  return (a >= 0) ? a / b : -((b - 1 - a) / b);
+}
+
+// the x in [-r, r] with a * x + b >= 0, as [*x0, *x1].
+static void half_plane(int a, int b, int r, int *x0, int *x1)
+{
+  *x0 = -r;
+  *x1 = r;
+  if (a > 0) {
+    int lo = -floor_div(b, a);  // ceil(-b / a)
+    if (lo > *x0) *x0 = lo;
+  } else if (a < 0) {
+    int hi = floor_div(b, -a);
+    if (hi < *x1) *x1 = hi;
+  } else if (b < 0) {
+    *x0 = 1;
+    *x1 = 0;
+  }
+}
+
+static void set_span(Span *span, int x0, int x1)
+{
+  if (x0 > x1) {
+    x0 = 1;
+    x1 = 0;
+  }
+  span->x0 = x0;
+  span->x1 = x1;
+}
+
+// The night runs clockwise from the sunset ray to the sunrise ray. A pixel
+// p is clockwise of the sunset ray s when cross(s, p) >= 0, and before the
+// sunrise ray r when cross(p, r) >= 0; on each row both tests are linear
+// in x, so each gives one run. Nights up to half a turn need both tests
+// (one span), longer ones either (up to two spans). Twilights are the same
+// sector for their own pair of rays.
+static void sector_row(int level, int y, Span *spans)
+{
+  GPoint s = ephemeris.dusk_point[level];
+  GPoint r = ephemeris.dawn_point[level];
+  const int radius = EPHEMERIS_NIGHT_RADIUS;
+
+  set_span(&spans[1], 1, 0);
+  if (ephemeris.polar[level] == SUNCALC_ALWAYS_BELOW) {
+    set_span(&spans[0], -radius, radius);
+    return;
+  }
+  if (ephemeris.polar[level] == SUNCALC_ALWAYS_ABOVE ||
+      (s.x == r.x && s.y == r.y)) {  // no usable dusk or dawn
+    set_span(&spans[0], 1, 0);
+    return;
+  }
+
+  int a0, a1, b0, b1;
+  half_plane(-s.y, s.x * y, radius, &a0, &a1);  // cross(s, p) >= 0
+  half_plane(r.y, -r.x * y, radius, &b0, &b1);  // cross(p, r) >= 0
+
+  if ((s.x * r.y - s.y * r.x) >= 0) {
+    set_span(&spans[0], (a0 > b0) ? a0 : b0, (a1 < b1) ? a1 : b1);
+  } else if (a0 > a1 || b0 > b1 || (a0 <= b1 + 1 && b0 <= a1 + 1)) {
+    // one run is empty, or they touch: a single span covers the union.
+    if (a0 > a1) { a0 = b0; a1 = b1; }
+    if (b0 > b1) { b0 = a0; b1 = a1; }
+    set_span(&spans[0], (a0 < b0) ? a0 : b0, (a1 > b1) ? a1 : b1);
+  } else {
+    set_span(&spans[0], a0, a1);
+    set_span(&spans[1], b0, b1);
+  }
+}
+
+// which level's sector row y shows, so that each band is hatched one row
+// in four darker than the one before it.
+static int hatch_level(int y)
+{
+  static const uint8_t levels[4] = {
+    EPHEMERIS_SUN, EPHEMERIS_NAUTICAL, EPHEMERIS_CIVIL, EPHEMERIS_ASTRONOMICAL
+  };
+  return levels[y & 3];
+}
+
+static void build_night_spans(void)
+{
+  for (int row = 0; row < EPHEMERIS_NIGHT_ROWS; row++) {
+    int y = row - EPHEMERIS_NIGHT_RADIUS;
+    sector_row(EPHEMERIS_SUN, y, ephemeris.night[row]);
+    sector_row(hatch_level(y), y, ephemeris.twilight[row]);
+  }
+}
+
+float moon_phase(const struct tm *time) {
+  int y,m;
+  double jd;
+  int jdn;
+  y = time->tm_year + 1900;
+  m = time->tm_mon + 1;
+  jdn = time->tm_mday-32075+1461*(y+4800+(m-14)/12)/4+367*(m-2-(m-14)/12*12)/12-3*((y+4900+(m-14)/12)/100)/4;
+  jd = jdn-2451550.1;
+  jd /= 29.530588853;
+  jd -= (int)jd;
+  if (jd < 0) jd += 1; /* dates before the reference new moon */
+  return (float)jd;
+}
+
+bool ephemeris_update(const struct tm *now, float latitude, float longitude, float utc_offset)
+{
+  if (ephemeris.valid &&
+      ephemeris.year == now->tm_year &&
+      ephemeris.yday == now->tm_yday &&
+      ephemeris.latitude == latitude &&
+      ephemeris.longitude == longitude &&
+      ephemeris.utc_offset == utc_offset) {
+    return false;
+  }
+
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Re-calculating ephemeris...");
+  ephemeris.year = now->tm_year;
+  ephemeris.yday = now->tm_yday;
+  ephemeris.latitude = latitude;
+  ephemeris.longitude = longitude;
+  ephemeris.utc_offset = utc_offset;
+
+  // all four levels in one go; the twilights are nearly free once the
+  // sun's position for the day is known.
+  static const float zeniths[EPHEMERIS_LEVELS] = {
+    91.0f, ZENITH_CIVIL, ZENITH_NAUTICAL, ZENITH_ASTRONOMICAL
+  };
+  SunEvents events;
+  calcSunEvents(now->tm_year, now->tm_mon+1, now->tm_mday, latitude, longitude,
+		zeniths, EPHEMERIS_LEVELS, &events);
+
+  // the table from the phone is more accurate for the sunrise/sunset
+  // themselves, when it covers today and was computed here.
+  float sunrise, sunset;
+  int32_t day = days_from_civil(now->tm_year + 1900, now->tm_mon + 1, now->tm_mday);
+  if (sun_table_lookup(day, latitude, longitude, &sunrise, &sunset)) {
+    events.rise[EPHEMERIS_SUN] = sunrise;
+    events.set[EPHEMERIS_SUN] = sunset;
+  }
+  ephemeris.sunrise = to_dial_hours(events.rise[EPHEMERIS_SUN], utc_offset);
+  ephemeris.sunset = to_dial_hours(events.set[EPHEMERIS_SUN], utc_offset);
+  for (int level = 0; level < EPHEMERIS_LEVELS; level++) {
+    ephemeris.dawn_point[level] = wedge_point(to_dial_hours(events.rise[level], utc_offset));
+    ephemeris.dusk_point[level] = wedge_point(to_dial_hours(events.set[level], utc_offset));
+    ephemeris.polar[level] = events.polar[level];
+  }
+  ephemeris.moon_phase = moon_phase(now);
+  build_night_spans();
+
+  ephemeris.valid = true;
+  ephemeris.layout = EPHEMERIS_LAYOUT;
+  persist_write_data(EPHEMERIS_PERSIST_KEY, &ephemeris, EPHEMERIS_PERSIST_SIZE);
+  return true;
+}
+
+bool ephemeris_restore(void)
+{
+  // a record from a build with a different layout is just recomputed.
+  if (persist_get_size(EPHEMERIS_PERSIST_KEY) != (int) EPHEMERIS_PERSIST_SIZE ||
+      persist_read_data(EPHEMERIS_PERSIST_KEY, &ephemeris, EPHEMERIS_PERSIST_SIZE) != (int) EPHEMERIS_PERSIST_SIZE ||
+      ephemeris.layout != EPHEMERIS_LAYOUT) {
+    ephemeris.valid = false;
+  }
+  if (ephemeris.valid) {
+    build_night_spans();
+  }
+  return ephemeris.valid;
+}
+
+void ephemeris_invalidate(void)
+{
+  ephemeris.valid = false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <pebble.h>
+#include "dial_layout.h"
+#include "raster.h"
+#include "suncalc.h"
+
+// radius at which the sunrise/sunset vertices of the night wedge are placed,
+// far enough out that the wedge edges reach the bezel.
+#define EPHEMERIS_WEDGE_RADIUS 120
+
+// the last computed record is kept here, so a cold start can draw today's
+// face before the phone answers.
+#define EPHEMERIS_PERSIST_KEY 0x30
+
+// the night region is kept as spans for every row of the dial interior.
+#define EPHEMERIS_NIGHT_RADIUS DIAL_INTERIOR_RADIUS
+#define EPHEMERIS_NIGHT_ROWS (2 * EPHEMERIS_NIGHT_RADIUS + 1)
+
+// how far below the horizon the sun is: level 0 is sunset/sunrise, then
+// the ends of civil, nautical and astronomical twilight.
+enum {
+  EPHEMERIS_SUN = 0,
+  EPHEMERIS_CIVIL,
+  EPHEMERIS_NAUTICAL,
+  EPHEMERIS_ASTRONOMICAL,
+  EPHEMERIS_LEVELS
+};
+
+/*
+ * Everything the face needs to know about the sun and moon for one day at
+ * one place. It is recomputed only when one of the inputs changes and is
+ * shared by every layer.
+ */
+typedef struct {
+  uint32_t layout;         // see EPHEMERIS_LAYOUT in ephemeris.c
+  bool valid;
+  // inputs the record was computed for
+  int year;
+  int yday;
+  float latitude;
+  float longitude;
+  float utc_offset;        // hours, including any DST adjustment
+  // sunrise/sunset in dial hours (local time + 12, so midnight is at the bottom)
+  float sunrise;
+  float sunset;
+  // for each level, the wedge vertices on a circle of EPHEMERIS_WEDGE_RADIUS
+  // around the dial centre where the sun sinks below it in the evening and
+  // comes back in the morning, and whether it crosses it at all (SUNCALC_*)
+  GPoint dusk_point[EPHEMERIS_LEVELS];
+  GPoint dawn_point[EPHEMERIS_LEVELS];
+  uint8_t polar[EPHEMERIS_LEVELS];
+  float moon_phase;        // fraction of the lunation: 0 new, 0.5 full, see moon_phase()
+  // per row of the dial interior, x relative to the dial centre; rebuilt
+  // from the points rather than persisted.
+  // the wedge between the sunset and sunrise rays
+  Span night[EPHEMERIS_NIGHT_ROWS][RASTER_SPANS_PER_ROW];
+  // the night with its twilight bands hatched in: a row only covers the
+  // sector of one level, so the civil band is black on 1 row in 4, the
+  // nautical on 2, the astronomical on 3, and full night on all of them.
+  Span twilight[EPHEMERIS_NIGHT_ROWS][RASTER_SPANS_PER_ROW];
+} Ephemeris;
+
+extern Ephemeris ephemeris;
+
+// returns true when the record had to be recomputed (and persisted).
+bool ephemeris_update(const struct tm *now, float latitude, float longitude, float utc_offset);
+// loads the persisted record; ephemeris_update still checks that it is
+// for today and the current place.
+bool ephemeris_restore(void);
+void ephemeris_invalidate(void);
+// age of the moon at noon UT on the date in `time', as a fraction of the
+// synodic month in [0, 1).
+float moon_phase(const struct tm *time);
@@ -1,14 +1,168 @@
 var config_url = "http://mtc.nfshost.com/sunset-watch-config.html"
+// set along with RENDER_STATS (src/render_stats.h) to have opening the
+// configuration page fetch the watch's profiling summary.
+var request_render_stats = false;
+
+/******************
+  PROTOCOL
+*******************/
+// must match PROTOCOL_VERSION and the FLAG_* bits in src/sunset-watch.c.
+var protocol_version = 1;
+var setting_flags = {
+    "second_hand":      1 << 0,
+    "digital_display":  1 << 1,
+    "hour_numbers":     1 << 2,
+    "moon_phase":       1 << 3,
+    "battery_status":   1 << 4,
+    "daylight_savings": 1 << 5,
+    "tz_bool":          1 << 6
+};
+
+// every message is stamped with the protocol version; the watch ignores
+// anything else.
+function send_message(message, success, failure) {
+    message.protocol = protocol_version;
+    Pebble.sendAppMessage(message, success, failure);
+}
+
+function micro_degrees(degrees) {
+    return Math.round(degrees * 1000000);
+}
+
+// the configuration page's options, packed for the watch.
+function settings_message(options) {
+    var flags = 0;
+    for (var name in setting_flags) {
+	if (Number(options[name]) == 1) {
+	    flags |= setting_flags[name];
+	}
+    }
+    var message = timezone_message();
+    message.flags = flags;
+    message.tz_offset = Math.round(Number(options.tz_offset) || 0);
+    message.glance_seconds = Number(options.glance_seconds) || 0;
+    message.city = Number(options.city) || 0;
+    return message;
+}
+
+// the city picked on the configuration page (0: none); the watch looks it
+// up in its own table, so the phone has no location to send.
+function manual_city() {
+    return Number(window.localStorage.sunset_watch_city) || 0;
+}
+
+/******************
+  TIMEZONE
+*******************/
+// must match TZ_SCHEDULE_MAX_TRANSITIONS in src/tz_schedule.h.
+var tz_max_transitions = 4;
+// how far ahead to look for DST transitions.
+var tz_horizon_days = 2 * 366;
+
+// minutes east of UTC at the instant `ms'.
+function utc_offset_at(ms) {
+    return -new Date(ms).getTimezoneOffset();
+}
+
+// the phone's offset now and its next transitions, as the watch's
+// tz_schedule_receive() takes them. Transitions are found a day at a
+// time, then narrowed down to the minute.
+function timezone_message() {
+    var minute = 60 * 1000, day = 24 * 60 * minute;
+    var now = Math.floor(new Date().getTime() / minute) * minute;
+    var offset = utc_offset_at(now);
+    var bytes = [];
+    for (var t = now; t < now + tz_horizon_days * day && bytes.length < tz_max_transitions * 6; t += day) {
+	var next = utc_offset_at(t + day);
+	if (next == offset) {
+	    continue;
+	}
+	var lo = t / minute, hi = (t + day) / minute;  // offset at lo, next at hi
+	while (hi - lo > 1) {
+	    var mid = Math.floor((lo + hi) / 2);
+	    if (utc_offset_at(mid * minute) == offset) lo = mid; else hi = mid;
+	}
+	var seconds = hi * 60;
+	bytes.push(seconds & 0xFF, (seconds >>> 8) & 0xFF, (seconds >>> 16) & 0xFF, (seconds >>> 24) & 0xFF,
+		   next & 0xFF, (next >> 8) & 0xFF);
+	offset = next;
+    }
+    return { "utc_offset": utc_offset_at(now), "tz_transitions": bytes };
+}
+
+/******************
+  LOCATION
+*******************/
+// a cached, coarse fix is plenty: sunrise and sunset move by about four
+// seconds per kilometre, so there is no point waking the GPS.
+var location_options = { "enableHighAccuracy": false,
+			 "maximumAge": 30 * 60 * 1000,
+			 "timeout": 60 * 1000 };
+// fixes closer than this to the last one sent are not sent again...
+var location_min_move_km = 5;
+// ...unless that was long enough ago that the watch may have lost it.
+var location_resend_ms = 24 * 60 * 60 * 1000;
+// travellers get a new fix this often while the face is running.
+var location_refresh_ms = 30 * 60 * 1000;
+// after a failure, retry after 30 s, 1 min, 2 min, ... up to the refresh
+// period. Failed sun table chunks back off the same way.
+var location_retry_ms = 30 * 1000;
+
+var location_timer = null;
+var location_failures = 0;
+
+function request_location() {
+    location_timer = null;
+    if (manual_city()) {
+	console.log("Manual city " + manual_city() + "; not asking for a location.");
+	return;
+    }
+    navigator.geolocation.getCurrentPosition(coords_received, coords_failed, location_options);
+}
+
+function schedule_location(delay) {
+    if (location_timer !== null) {
+	clearTimeout(location_timer);
+    }
+    location_timer = setTimeout(request_location, delay);
+}
+
+// great-circle distance; the difference between a sphere and the real
+// Earth doesn't matter for a threshold.
+function distance_km(lat1, lon1, lat2, lon2) {
+    var rad = Math.PI / 180;
+    var dlat = (lat2 - lat1) * rad;
+    var dlon = (lon2 - lon1) * rad;
+    var a = Math.sin(dlat / 2) * Math.sin(dlat / 2) +
+	Math.cos(lat1 * rad) * Math.cos(lat2 * rad) * Math.sin(dlon / 2) * Math.sin(dlon / 2);
+    return 6371 * 2 * Math.atan2(Math.sqrt(a), Math.sqrt(1 - a));
+}
+
+// the last position the watch acknowledged, or null.
+function last_sent_location() {
+    try {
+	return JSON.parse(window.localStorage.sunset_watch_location || "null");
+    } catch (e) {
+	return null;
+    }
+}
 
 Pebble.addEventListener("ready",
     function(e) {
         console.log("JS starting...");
-	navigator.geolocation.getCurrentPosition(coords_received,coords_failed);
+	// the offset first: the watch may have been off across a transition.
+	send_message( timezone_message(),
+		      function(e) { request_location(); },
+		      function(e) { console.log("Timezone not delivered.");
+				    request_location(); } );
     }
 );
 
 function coords_failed(err) {
-    console.log("Didn't get coordinates with error: " + err.code);
+    var delay = Math.min(location_retry_ms * Math.pow(2, location_failures), location_refresh_ms);
+    location_failures++;
+    console.log("Didn't get coordinates with error: " + err.code + "; retrying in " + delay / 1000 + " s");
+    schedule_location(delay);
 }
 
 function coords_received(position) {
@@ -16,22 +170,164 @@ function coords_received(position) {
     //    position.coords.latitude = 40.67;
     //    position.coords.longitude = -73.94;
 
-    console.log("Got latitude: " + position.coords.latitude);
-    console.log("Got longitude: " + position.coords.longitude);
+    var latitude = position.coords.latitude;
+    var longitude = position.coords.longitude;
+    console.log("Got latitude: " + latitude);
+    console.log("Got longitude: " + longitude);
+
+    location_failures = 0;
+    schedule_location(location_refresh_ms);
 
-    Pebble.sendAppMessage( { "latitude": position.coords.latitude.toString(),
-			     "longitude": position.coords.longitude.toString() },
-		       function(e) { console.log("Successfully delivered message with transactionId="
-						 + e.data.transactionId); },
-		       function(e) { console.log("Unsuccessfully delivered message with transactionId="
-						 + e.data.transactionId); });
+    var last = last_sent_location();
+    var now = new Date().getTime();
+    if (last && now - last.time < location_resend_ms) {
+	var moved = distance_km(last.latitude, last.longitude, latitude, longitude);
+	if (moved < location_min_move_km) {
+	    console.log("Moved " + moved.toFixed(1) + " km; not sending.");
+	    return;
+	}
+    }
+
+    send_message( { "latitude_e6": micro_degrees(latitude),
+		    "longitude_e6": micro_degrees(longitude) },
+		  function(e) { console.log("Successfully delivered message with transactionId="
+					    + e.data.transactionId);
+				window.localStorage.sunset_watch_location =
+				    JSON.stringify({ "latitude": latitude, "longitude": longitude, "time": now });
+				send_sun_table(latitude, longitude); },
+		  function(e) { console.log("Unsuccessfully delivered message with transactionId="
+					    + e.data.transactionId); });
+}
+
+/******************
+  SUNRISE/SUNSET TABLE
+*******************/
+// must match SUN_TABLE_ROWS_PER_CHUNK and SUN_TABLE_NO_EVENT in src/sun_table.h.
+var sun_table_days = 366;
+var sun_table_rows_per_chunk = 64;
+var sun_table_no_event = 0xFFFF;
+
+// same Almanac algorithm as calcSun() in src/suncalc.c, at full precision.
+// returns hours after 00:00 UT, or null when the sun doesn't rise/set.
+function calc_sun(year, month, day, latitude, longitude, sunset, zenith) {
+    var rad = Math.PI / 180;
+    var N1 = Math.floor(275 * month / 9);
+    var N2 = Math.floor((month + 9) / 12);
+    var N3 = (1 + Math.floor((year - 4 * Math.floor(year / 4) + 2) / 3));
+    var N = N1 - (N2 * N3) + day - 30;
+
+    var lngHour = longitude / 15;
+    var t = N + (((sunset ? 18 : 6) - lngHour) / 24);
+    var M = (0.9856 * t) - 3.289;
+
+    var L = M + (1.916 * Math.sin(rad * M)) + (0.020 * Math.sin(rad * 2 * M)) + 282.634;
+    L = (L + 360) % 360;
+
+    var RA = Math.atan(0.91764 * Math.tan(rad * L)) / rad;
+    RA = (RA + 360) % 360;
+    RA += (Math.floor(L / 90) * 90) - (Math.floor(RA / 90) * 90);
+    RA /= 15;
+
+    var sinDec = 0.39782 * Math.sin(rad * L);
+    var cosDec = Math.cos(Math.asin(sinDec));
+    var cosH = (Math.cos(rad * zenith) - (sinDec * Math.sin(rad * latitude))) / (cosDec * Math.cos(rad * latitude));
+    if (cosH > 1 || cosH < -1) {
+	return null;
+    }
+
+    var H = Math.acos(cosH) / rad;
+    if (!sunset) {
+	H = 360 - H;
+    }
+    H /= 15;
+
+    var T = H + RA - (0.06571 * t) - 6.622;
+    return (T - lngHour + 48) % 24;
+}
+
+function sun_table_minutes(hours) {
+    return (hours === null) ? sun_table_no_event : Math.round(hours * 60) % 1440;
+}
+
+// rows start today (local date); `start' is days since 1970-01-01.
+function build_sun_table(latitude, longitude) {
+    var now = new Date();
+    var start = Math.floor(Date.UTC(now.getFullYear(), now.getMonth(), now.getDate()) / 86400000);
+    var rows = [];
+    for (var i = 0; i < sun_table_days; i++) {
+	var date = new Date((start + i) * 86400000);
+	var year = date.getUTCFullYear() - 1900;
+	var month = date.getUTCMonth() + 1;
+	var day = date.getUTCDate();
+	var sunrise = sun_table_minutes(calc_sun(year, month, day, latitude, longitude, false, 91.0));
+	var sunset = sun_table_minutes(calc_sun(year, month, day, latitude, longitude, true, 91.0));
+	rows.push(sunrise & 0xFF, sunrise >> 8, sunset & 0xFF, sunset >> 8);
+    }
+    return { start: start, bytes: rows };
+}
+
+var sun_table_timer = null;
+var sun_table_generation = 0;
+
+// sends the table a chunk at a time, waiting for each to be acked. A
+// failed chunk is retried with a backoff, since the whole table is only
+// sent again after a move or a day; a newer table replaces the retries.
+function send_sun_table(latitude, longitude) {
+    var table = build_sun_table(latitude, longitude);
+    var chunk_bytes = sun_table_rows_per_chunk * 4;
+    var failures = 0;
+    var generation = ++sun_table_generation;
+
+    if (sun_table_timer !== null) {
+	clearTimeout(sun_table_timer);
+	sun_table_timer = null;
+    }
+
+    function chunk_failed(offset) {
+	if (generation !== sun_table_generation) {
+	    return;
+	}
+	var delay = Math.min(location_retry_ms * Math.pow(2, failures), location_refresh_ms);
+	failures++;
+	console.log("Sun table chunk at row " + offset + " failed; retrying in " + delay / 1000 + " s");
+	sun_table_timer = setTimeout(function() {
+	    sun_table_timer = null;
+	    send_chunk(offset);
+	}, delay);
+    }
+
+    function send_chunk(offset) {
+	if (generation !== sun_table_generation) {
+	    return;
+	}
+	if (offset >= sun_table_days) {
+	    console.log("Sun table sent.");
+	    return;
+	}
+	send_message( { "sun_table_start": table.start,
+			"sun_table_offset": offset,
+			"sun_table_count": sun_table_days,
+			"sun_table_data": table.bytes.slice(offset * 4, offset * 4 + chunk_bytes) },
+		      function(e) { failures = 0;
+				    send_chunk(offset + sun_table_rows_per_chunk); },
+		      function(e) { chunk_failed(offset); });
+    }
+    send_chunk(0);
 }
 
 Pebble.addEventListener("appmessage", function(e) {
     console.log("Received from phone: " + JSON.stringify(e.payload));
+    if (e.payload.render_stats) {
+	// per layer: min/avg/max ms and average draw calls over recent frames
+	console.log("Render stats: " + e.payload.render_stats);
+    }
 });
 			
 Pebble.addEventListener("showConfiguration", function(e) {
+    if (request_render_stats) {
+	// the summary comes back through the "appmessage" listener.
+	send_message({ "render_stats": 1 });
+    }
     Pebble.openURL(config_url);
 });
 
@@ -41,7 +337,13 @@ Pebble.addEventListener("webviewclosed", function(e) {
     if (e.response) {
 	var options = JSON.parse(decodeURIComponent(e.response));
 	console.log("Options = " + JSON.stringify(options));
-	Pebble.sendAppMessage( options );
+	var had_city = manual_city();
+	window.localStorage.sunset_watch_city = Number(options.city) || 0;
+	send_message( settings_message(options) );
+	if (had_city && !manual_city()) {
+	    // back to the phone's location; the watch may only have an old fix.
+	    schedule_location(0);
+	}
     }
     else {
 	console.log("User clicked cancel.");
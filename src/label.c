@@ -0,0 +1,125 @@
+#include "label.h"
+#include "render_stats.h"
+
+// results are pretty awful for `outline_pixel' values larger than 2...
+void draw_outlined_text(GContext* ctx, char* text, GFont font, GRect rect, GTextOverflowMode mode, GTextAlignment alignment, int outline_pixels, bool inverted) {
+  (inverted) ? graphics_context_set_text_color(ctx, GColorBlack) :
+    graphics_context_set_text_color(ctx, GColorWhite);
+
+  GRect volatile_rect = rect;
+  for (int i=0; i<outline_pixels; i++) {
+    volatile_rect.origin.x+=1;
+    graphics_draw_text(ctx,
+		       text,
+		       font,
+		       volatile_rect,
+		       mode,
+		       alignment,
+		       NULL);
+  }
+  volatile_rect = rect;
+  for (int i=0; i<outline_pixels; i++) {
+    volatile_rect.origin.y+=1;
+    graphics_draw_text(ctx,
+		       text,
+		       font,
+		       volatile_rect,
+		       mode,
+		       alignment,
+		       NULL);
+  }
+  volatile_rect = rect;
+  for (int i=0; i<outline_pixels; i++) {
+    volatile_rect.origin.x-=1;
+    graphics_draw_text(ctx,
+		       text,
+		       font,
+		       volatile_rect,
+		       mode,
+		       alignment,
+		       NULL);
+  }
+  volatile_rect = rect;
+  for (int i=0; i<outline_pixels; i++) {
+    volatile_rect.origin.y-=1;
+    graphics_draw_text(ctx,
+		       text,
+		       font,
+		       volatile_rect,
+		       mode,
+		       alignment,
+		       NULL);
+  }
+  (inverted) ? graphics_context_set_text_color(ctx, GColorWhite) :
+    graphics_context_set_text_color(ctx, GColorBlack);
+  graphics_draw_text(ctx,
+		     text,
+		     font,
+		     rect,
+		     mode,
+		     alignment,
+		     NULL);
+}
+
+static void draw_label(GContext *ctx, void *data) {
+  Label *label = data;
+  draw_outlined_text(ctx, label->text, label->font, label->box, GTextOverflowModeWordWrap,
+                     label->alignment, label->outline_pixels, label->inverted);
+}
+
+void label_init(Label *label, GRect box, GPoint layer_origin, GFont font, GTextAlignment alignment, int outline_pixels, bool inverted) {
+  label->box = box;
+  label->font = font;
+  label->alignment = alignment;
+  label->outline_pixels = outline_pixels;
+  label->inverted = inverted;
+  label->text[0] = '\0';
+  label->cached = true;
+
+  // text without an outline is a single graphics_draw_text, which is
+  // cheaper than the two bitmap draws of a sprite.
+  label->sprite.and_mask = NULL;
+  label->sprite.or_mask = NULL;
+  label->sprite.valid = false;
+  if (outline_pixels == 0) {
+    return;
+  }
+  // the outline reaches `outline_pixels' past the text box on every side.
+  GRect rect = box;
+  rect.origin.x -= outline_pixels;
+  rect.origin.y -= outline_pixels;
+  rect.size.w += 2 * outline_pixels;
+  rect.size.h += 2 * outline_pixels;
+  sprite_init(&label->sprite, rect, layer_origin);
+}
+
+void label_deinit(Label *label) {
+  sprite_deinit(&label->sprite);
+}
+
+void label_set_cached(Label *label, bool cached) {
+  label->cached = cached;
+}
+
+bool label_set_text(Label *label, const char *text) {
+  if (strncmp(label->text, text, sizeof(label->text)) == 0) {
+    return false;
+  }
+  strncpy(label->text, text, sizeof(label->text) - 1);
+  label->text[sizeof(label->text) - 1] = '\0';
+  sprite_invalidate(&label->sprite);
+  return true;
+}
+
+void label_draw(Label *label, GContext *ctx) {
+  if (!label->cached || !label->sprite.and_mask) {
+    // uncached, no outline or not enough memory for the cache.
+    draw_label(ctx, label);
+    return;
+  }
+  if (!label->sprite.valid && !sprite_render(&label->sprite, ctx, draw_label, label)) {
+    draw_label(ctx, label);
+    return;
+  }
+  sprite_draw(&label->sprite, ctx);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <pebble.h>
+#include "sprite.h"
+
+#define LABEL_MAX_TEXT 8
+
+// draws `text' in `rect' with a 1-bit outline `outline_pixels' wide: white
+// text outlined in black, or black outlined in white when `inverted'.
+void draw_outlined_text(GContext* ctx, char* text, GFont font, GRect rect, GTextOverflowMode mode, GTextAlignment alignment, int outline_pixels, bool inverted);
+
+/*
+ * A short outlined text, optionally kept pre-rendered in a sprite. Outlined
+ * text costs 4 * outline_pixels + 1 graphics_draw_text calls, so a cached
+ * label renders it once and re-renders only when label_set_text actually
+ * changes the text; every other frame is two bitmap draws. That only pays
+ * off for an outline and for text that outlives several frames: a label
+ * without an outline is never cached, and one whose text changes about as
+ * often as it is drawn should be drawn directly (see label_set_cached).
+ */
+typedef struct {
+  Sprite sprite;           // no masks when the label has no outline
+  GRect box;               // the text box, in layer coordinates
+  GFont font;
+  GTextAlignment alignment;
+  int outline_pixels;
+  bool inverted;
+  bool cached;
+  char text[LABEL_MAX_TEXT];
+} Label;
+
+// `box' is in the coordinates of the layer the label is drawn in;
+// `layer_origin' is that layer's position on the screen.
+void label_init(Label *label, GRect box, GPoint layer_origin, GFont font, GTextAlignment alignment, int outline_pixels, bool inverted);
+void label_deinit(Label *label);
+// whether label_draw goes through the sprite; labels start out cached.
+void label_set_cached(Label *label, bool cached);
+// returns true when the text changed and the label needs redrawing.
+bool label_set_text(Label *label, const char *text);
+// must be called from inside the update proc of the label's layer.
+void label_draw(Label *label, GContext *ctx);
@@ -5,6 +5,14 @@
  */
 #include "my_math.h"
 
+/*
+ * Two trig backends are available:
+ * - lookup tables with linear interpolation (the default), which are also
+ *   exposed as integer functions working in MY_TRIG_MAX_ANGLE units;
+ * - the minimax polynomials, when built with -DMY_MATH_POLYNOMIAL; kept
+ *   around for accuracy comparisons.
+ */
+
 #define SQRT_MAGIC_F 0x5f3759df 
 float my_sqrt(const float x)
 {
@@ -31,6 +39,15 @@ float my_fabs(float x)
   return x;
 }
 
+/* not quite rint(), i.e. results not properly rounded to nearest-or-even */
+float my_rint (float x)
+{
+  float t = my_floor (my_fabs(x) + 0.5);
+  return (x < 0.0) ? -t : t;
+}
+
+#ifdef MY_MATH_POLYNOMIAL
+
 float my_atan(float x)
 {
   if (x>0) 
@@ -43,13 +60,6 @@ float my_atan(float x)
   }
 }
 
-/* not quite rint(), i.e. results not properly rounded to nearest-or-even */
-float my_rint (float x)
-{
-  float t = my_floor (my_fabs(x) + 0.5);
-  return (x < 0.0) ? -t : t;
-}
-
 /* minimax approximation to cos on [-pi/4, pi/4] with rel. err. ~= 7.5e-13 */
 float cos_core (float x)
 {
@@ -137,4 +147,228 @@ float my_asin (float x)
 float my_tan(float x)
 {
   return my_sin(x) / my_cos(x);
-}
\ No newline at end of file
+}
+
+#endif /* MY_MATH_POLYNOMIAL */
+
+/*
+ * Table backend. Each table covers its interval in TABLE_STEPS linear
+ * pieces; the angle tables are kept in quarter angle units for a couple
+ * more bits of precision.
+ */
+#define TABLE_STEPS 128
+#define QUARTER_TURN_Q (MY_TRIG_MAX_ANGLE)       /* 90 degrees in quarter angle units */
+#define HALF_TURN_Q (2 * MY_TRIG_MAX_ANGLE)
+#define FULL_TURN_Q (4 * MY_TRIG_MAX_ANGLE)
+
+/* sin(x) for x in [0, pi/2], Q16 (the last entry is clamped; see sin_fine) */
+static const uint16_t sin_table[TABLE_STEPS + 1] = {
+      0,   804,  1608,  2412,  3216,  4019,  4821,  5623,  6424,  7224,
+   8022,  8820,  9616, 10411, 11204, 11996, 12785, 13573, 14359, 15143,
+  15924, 16703, 17479, 18253, 19024, 19792, 20557, 21320, 22078, 22834,
+  23586, 24335, 25080, 25821, 26558, 27291, 28020, 28745, 29466, 30182,
+  30893, 31600, 32303, 33000, 33692, 34380, 35062, 35738, 36410, 37076,
+  37736, 38391, 39040, 39683, 40320, 40951, 41576, 42194, 42806, 43412,
+  44011, 44604, 45190, 45769, 46341, 46906, 47464, 48015, 48559, 49095,
+  49624, 50146, 50660, 51166, 51665, 52156, 52639, 53114, 53581, 54040,
+  54491, 54934, 55368, 55794, 56212, 56621, 57022, 57414, 57798, 58172,
+  58538, 58896, 59244, 59583, 59914, 60235, 60547, 60851, 61145, 61429,
+  61705, 61971, 62228, 62476, 62714, 62943, 63162, 63372, 63572, 63763,
+  63944, 64115, 64277, 64429, 64571, 64704, 64827, 64940, 65043, 65137,
+  65220, 65294, 65358, 65413, 65457, 65492, 65516, 65531, 65535
+};
+
+/* atan(t) for t in [0, 1], in quarter angle units */
+static const uint16_t atan_table[TABLE_STEPS + 1] = {
+      0,   326,   652,   978,  1303,  1629,  1954,  2279,  2604,  2929,
+   3253,  3577,  3900,  4223,  4545,  4867,  5188,  5509,  5829,  6148,
+   6467,  6784,  7101,  7418,  7733,  8047,  8361,  8673,  8985,  9296,
+   9605,  9914, 10221, 10527, 10832, 11136, 11439, 11740, 12040, 12339,
+  12637, 12933, 13228, 13522, 13814, 14105, 14394, 14682, 14968, 15253,
+  15537, 15819, 16100, 16379, 16656, 16932, 17206, 17479, 17750, 18020,
+  18288, 18554, 18819, 19083, 19344, 19604, 19862, 20119, 20374, 20627,
+  20879, 21129, 21378, 21624, 21870, 22113, 22355, 22595, 22834, 23070,
+  23306, 23539, 23771, 24001, 24230, 24457, 24682, 24906, 25128, 25349,
+  25568, 25785, 26001, 26215, 26427, 26638, 26848, 27056, 27262, 27467,
+  27670, 27871, 28072, 28270, 28467, 28663, 28857, 29050, 29241, 29430,
+  29619, 29805, 29991, 30175, 30357, 30538, 30718, 30896, 31073, 31248,
+  31423, 31595, 31767, 31937, 32106, 32273, 32439, 32604, 32768
+};
+
+/* asin(s) for s in [0, 1/2], in quarter angle units */
+static const uint16_t asin_table[TABLE_STEPS + 1] = {
+      0,   163,   326,   489,   652,   815,   978,  1141,  1304,  1467,
+   1630,  1793,  1956,  2120,  2283,  2446,  2609,  2773,  2936,  3099,
+   3263,  3426,  3590,  3753,  3917,  4081,  4245,  4409,  4572,  4736,
+   4901,  5065,  5229,  5393,  5558,  5722,  5887,  6051,  6216,  6381,
+   6546,  6711,  6876,  7041,  7207,  7372,  7538,  7704,  7869,  8035,
+   8201,  8368,  8534,  8701,  8867,  9034,  9201,  9368,  9535,  9703,
+   9870, 10038, 10206, 10374, 10542, 10711, 10879, 11048, 11217, 11386,
+  11555, 11725, 11895, 12065, 12235, 12405, 12576, 12746, 12917, 13089,
+  13260, 13432, 13604, 13776, 13948, 14121, 14294, 14467, 14640, 14814,
+  14988, 15162, 15337, 15512, 15687, 15862, 16038, 16214, 16390, 16566,
+  16743, 16920, 17098, 17276, 17454, 17633, 17811, 17991, 18170, 18350,
+  18530, 18711, 18892, 19074, 19255, 19438, 19620, 19803, 19987, 20171,
+  20355, 20540, 20725, 20910, 21096, 21283, 21470, 21657, 21845
+};
+
+/* sin of an angle with 2^24 units per turn, Q16 */
+static int32_t sin_fine(uint32_t a)
+{
+  uint32_t quadrant = (a >> 22) & 3;
+  uint32_t r = a & 0x3FFFFF;
+  int32_t v;
+  if (quadrant & 1) r = 0x400000 - r;
+  if (r >= 0x400000) {
+    v = MY_TRIG_ONE;
+  } else {
+    uint32_t i = r >> 15;
+    int32_t f = r & 0x7FFF;
+    v = sin_table[i] + (((sin_table[i+1] - sin_table[i]) * f) >> 15);
+  }
+  return (quadrant & 2) ? -v : v;
+}
+
+/* atan(num / den) for 0 <= num <= den, in quarter angle units */
+static int32_t atan_quarter(uint32_t num, uint32_t den)
+{
+  if (den == 0) return 0;
+  while (den > 0xFFFF) {
+    num >>= 1;
+    den >>= 1;
+  }
+  uint32_t t = (num << 16) / den;
+  uint32_t i = t >> 9;
+  int32_t f = t & 0x1FF;
+  if (i >= TABLE_STEPS) return atan_table[TABLE_STEPS];
+  return atan_table[i] + (((atan_table[i+1] - atan_table[i]) * f) >> 9);
+}
+
+/* in quarter angle units, [0, FULL_TURN_Q) */
+static int32_t atan2_quarter(int32_t y, int32_t x)
+{
+  uint32_t ax = (x < 0) ? -x : x;
+  uint32_t ay = (y < 0) ? -y : y;
+  int32_t a = (ax >= ay) ? atan_quarter(ay, ax) : QUARTER_TURN_Q - atan_quarter(ax, ay);
+  if (x < 0) a = HALF_TURN_Q - a;
+  if (y < 0) a = FULL_TURN_Q - a;
+  return a & (FULL_TURN_Q - 1);
+}
+
+/* asin(s) for s in [0, 1/2] (Q16), in quarter angle units */
+static int32_t asin_quarter(int32_t s)
+{
+  uint32_t i = s >> 8;
+  int32_t f = s & 0xFF;
+  if (i >= TABLE_STEPS) return asin_table[TABLE_STEPS];
+  return asin_table[i] + (((asin_table[i+1] - asin_table[i]) * f) >> 8);
+}
+
+/* acos(x) for x in [-1, 1] (Q16), in quarter angle units */
+static int32_t acos_quarter(int32_t x)
+{
+  int32_t xa, t;
+  if (x > MY_TRIG_ONE) x = MY_TRIG_ONE;
+  if (x < -MY_TRIG_ONE) x = -MY_TRIG_ONE;
+  xa = (x < 0) ? -x : x;
+  /* same identities as the polynomial my_acos */
+  if (xa > MY_TRIG_ONE / 2) {
+    t = 2 * asin_quarter(my_isqrt((uint32_t)(MY_TRIG_ONE - xa) << 15));
+  } else {
+    t = QUARTER_TURN_Q - asin_quarter(xa);
+  }
+  return (x < 0) ? (HALF_TURN_Q - t) : t;
+}
+
+int32_t my_sin_lookup(int32_t angle)
+{
+  return sin_fine((uint32_t)angle << 8);
+}
+
+int32_t my_cos_lookup(int32_t angle)
+{
+  return sin_fine((uint32_t)(angle + MY_TRIG_MAX_ANGLE / 4) << 8);
+}
+
+int32_t my_atan2_lookup(int32_t y, int32_t x)
+{
+  return ((atan2_quarter(y, x) + 2) >> 2) & (MY_TRIG_MAX_ANGLE - 1);
+}
+
+int32_t my_acos_lookup(int32_t x)
+{
+  return (acos_quarter(x) + 2) >> 2;
+}
+
+#ifndef MY_MATH_POLYNOMIAL
+
+#define QUARTER_ANGLE_TO_RAD ((float)(2 * M_PI / FULL_TURN_Q))
+
+/* x in radians to 2^24 units per turn */
+static int32_t fine_angle(float x)
+{
+  float turns = x * (float)(1 / (2 * M_PI));
+  turns -= (int)turns;
+  return (int32_t)(turns * 16777216.0f);
+}
+
+float my_sin(float x)
+{
+  return sin_fine(fine_angle(x)) * (1.0f / MY_TRIG_ONE);
+}
+
+float my_cos(float x)
+{
+  return sin_fine(fine_angle(x) + 0x400000) * (1.0f / MY_TRIG_ONE);
+}
+
+float my_tan(float x)
+{
+  int32_t a = fine_angle(x);
+  return sin_fine(a) / (float)sin_fine(a + 0x400000);
+}
+
+float my_atan(float x)
+{
+  float xa = my_fabs(x);
+  float t;
+  if (xa <= 1) {
+    t = atan_quarter((uint32_t)(xa * MY_TRIG_ONE), MY_TRIG_ONE);
+  } else if (xa < 32768) {
+    t = QUARTER_TURN_Q - atan_quarter(MY_TRIG_ONE, (uint32_t)(xa * MY_TRIG_ONE));
+  } else {
+    t = QUARTER_TURN_Q;
+  }
+  t *= QUARTER_ANGLE_TO_RAD;
+  return (x < 0) ? -t : t;
+}
+
+float my_acos(float x)
+{
+  return acos_quarter((int32_t)(x * MY_TRIG_ONE)) * QUARTER_ANGLE_TO_RAD;
+}
+
+float my_asin(float x)
+{
+  return (M_PI/2) - my_acos(x);
+}
+
+#endif /* MY_MATH_POLYNOMIAL */
+
+/* floor(sqrt(x)), one result bit per iteration */
+unsigned int my_isqrt(unsigned int x)
+{
+  unsigned int res = 0;
+  unsigned int bit = 1u << 30;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= res + bit) {
+      x -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #define M_PI 3.141592653589793
 float my_sqrt(const float x);
 float my_floor(float x); 
@@ -9,3 +11,16 @@ float my_cos(float x);
 float my_acos (float x);
 float my_asin (float x);
 float my_tan(float x);
+unsigned int my_isqrt(unsigned int x);
+
+/*
+ * Integer trig on lookup tables. Angles use MY_TRIG_MAX_ANGLE units per
+ * turn (the same as Pebble's TRIG_MAX_ANGLE) and ratios are Q16, i.e.
+ * MY_TRIG_ONE is 1.0.
+ */
+#define MY_TRIG_MAX_ANGLE 0x10000
+#define MY_TRIG_ONE 0x10000
+int32_t my_sin_lookup(int32_t angle);
+int32_t my_cos_lookup(int32_t angle);
+int32_t my_atan2_lookup(int32_t y, int32_t x);   /* [0, MY_TRIG_MAX_ANGLE) */
+int32_t my_acos_lookup(int32_t x);               /* [0, MY_TRIG_MAX_ANGLE / 2] */
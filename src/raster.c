@@ -0,0 +1,178 @@
+/*
+ * Scanline fills for the shapes the face is built from.
+ */
+#include "raster.h"
+#include "my_math.h"
+#include "render_stats.h"
+
+static void fill_span(GContext *ctx, GRect clip, int y, int x0, int x1) {
+  int clip_x1 = clip.origin.x + clip.size.w - 1;
+  if (x0 < clip.origin.x) x0 = clip.origin.x;
+  if (x1 > clip_x1) x1 = clip_x1;
+  if (x0 > x1) return;
+  graphics_fill_rect(ctx, GRect(x0, y, x1 - x0 + 1, 1), 0, GCornerNone);
+}
+
+// fill_span, but only where the row of `mask' (if any) has pixels.
+static void fill_masked_span(GContext *ctx, GRect clip, const SpanMask *mask, int y, int x0, int x1) {
+  if (!mask) {
+    fill_span(ctx, clip, y, x0, x1);
+    return;
+  }
+  int row = y - mask->center.y + mask->radius;
+  if (row < 0 || row > 2 * mask->radius) return;
+  for (int i = 0; i < RASTER_SPANS_PER_ROW; i++) {
+    const Span *span = &mask->rows[row][i];
+    int span_x0 = mask->center.x + span->x0;
+    int span_x1 = mask->center.x + span->x1;
+    fill_span(ctx, clip, y, (x0 > span_x0) ? x0 : span_x0, (x1 < span_x1) ? x1 : span_x1);
+  }
+}
+
+void fill_span_mask(GContext *ctx, GRect clip, const SpanMask *mask) {
+  int rows = 2 * mask->radius + 1;
+  for (int row = 0; row < rows; row++) {
+    int y = mask->center.y - mask->radius + row;
+    if (y < clip.origin.y || y >= clip.origin.y + clip.size.h) continue;
+    for (int i = 0; i < RASTER_SPANS_PER_ROW; i++) {
+      const Span *span = &mask->rows[row][i];
+      fill_span(ctx, clip, y, mask->center.x + span->x0, mask->center.x + span->x1);
+    }
+  }
+}
+
+// sets (white) or clears pixels x0..x1 of a frame buffer row; the LSB of
+// each byte is its leftmost pixel.
+static void fill_row_bits(uint8_t *row, int x0, int x1, bool white) {
+  int first = x0 >> 3, last = x1 >> 3;
+  uint8_t first_mask = 0xFF << (x0 & 7);
+  uint8_t last_mask = 0xFF >> (7 - (x1 & 7));
+  if (first == last) {
+    first_mask &= last_mask;
+  }
+  row[first] = white ? (row[first] | first_mask) : (row[first] & ~first_mask);
+  if (first == last) {
+    return;
+  }
+  if (last - first > 1) {
+    memset(row + first + 1, white ? 0xFF : 0x00, last - first - 1);
+  }
+  row[last] = white ? (row[last] | last_mask) : (row[last] & ~last_mask);
+}
+
+void fill_span_mask_direct(GContext *ctx, GPoint layer_origin, GRect clip, const SpanMask *mask, GColor color) {
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    graphics_context_set_fill_color(ctx, color);
+    fill_span_mask(ctx, clip, mask);
+    return;
+  }
+  bool white = gcolor_equal(color, GColorWhite);
+  uint8_t *data = gbitmap_get_data(fb);
+  uint16_t bytes_per_row = gbitmap_get_bytes_per_row(fb);
+  GRect screen = gbitmap_get_bounds(fb);
+
+  // the clip, on the screen
+  int clip_x0 = layer_origin.x + clip.origin.x;
+  int clip_y0 = layer_origin.y + clip.origin.y;
+  int clip_x1 = clip_x0 + clip.size.w - 1;
+  int clip_y1 = clip_y0 + clip.size.h - 1;
+  if (clip_x0 < screen.origin.x) clip_x0 = screen.origin.x;
+  if (clip_y0 < screen.origin.y) clip_y0 = screen.origin.y;
+  if (clip_x1 > screen.origin.x + screen.size.w - 1) clip_x1 = screen.origin.x + screen.size.w - 1;
+  if (clip_y1 > screen.origin.y + screen.size.h - 1) clip_y1 = screen.origin.y + screen.size.h - 1;
+
+  int center_x = layer_origin.x + mask->center.x;
+  int rows = 2 * mask->radius + 1;
+  for (int row = 0; row < rows; row++) {
+    int y = layer_origin.y + mask->center.y - mask->radius + row;
+    if (y < clip_y0 || y > clip_y1) continue;
+    for (int i = 0; i < RASTER_SPANS_PER_ROW; i++) {
+      const Span *span = &mask->rows[row][i];
+      int x0 = center_x + span->x0;
+      int x1 = center_x + span->x1;
+      if (x0 < clip_x0) x0 = clip_x0;
+      if (x1 > clip_x1) x1 = clip_x1;
+      if (x0 <= x1) {
+        fill_row_bits(data + y * bytes_per_row, x0, x1, white);
+      }
+    }
+  }
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+static void fill_masked_annulus(GContext *ctx, GRect clip, const SpanMask *mask, GPoint center, int inner_radius, int outer_radius) {
+  // a pixel is inside a circle of radius r when x*x + y*y <= r*r + r,
+  // which matches the midpoint algorithm behind graphics_draw_circle.
+  int outer_sq = outer_radius * outer_radius + outer_radius;
+  int hole = inner_radius - 1;
+  int hole_sq = (hole >= 0) ? hole * hole + hole : -1;
+
+  int dy0 = clip.origin.y - center.y;
+  int dy1 = clip.origin.y + clip.size.h - 1 - center.y;
+  if (dy0 < -outer_radius) dy0 = -outer_radius;
+  if (dy1 > outer_radius) dy1 = outer_radius;
+
+  for (int dy=dy0; dy<=dy1; dy++) {
+    int dy_sq = dy * dy;
+    int y = center.y + dy;
+    int xo = my_isqrt(outer_sq - dy_sq);
+    if (dy_sq > hole_sq) {
+      fill_masked_span(ctx, clip, mask, y, center.x - xo, center.x + xo);
+    } else {
+      int xi = my_isqrt(hole_sq - dy_sq);
+      fill_masked_span(ctx, clip, mask, y, center.x - xo, center.x - xi - 1);
+      fill_masked_span(ctx, clip, mask, y, center.x + xi + 1, center.x + xo);
+    }
+  }
+}
+
+void fill_annulus(GContext *ctx, GRect clip, GPoint center, int inner_radius, int outer_radius) {
+  fill_masked_annulus(ctx, clip, NULL, center, inner_radius, outer_radius);
+}
+
+// floor(a / 16) for either sign.
+static int floor_div16(int a) {
+  return (a >= 0) ? a / 16 : -((15 - a) / 16);
+}
+
+void fill_moon(GContext *ctx, GRect clip, const SpanMask *mask, GPoint center, int radius, float phase) {
+  phase -= (int)phase;
+  if (phase < 0) phase += 1;
+  int32_t k = my_cos_lookup((int32_t)(phase * MY_TRIG_MAX_ANGLE));
+  bool waxing = phase < 0.5f;
+  int radius_sq = radius * radius + radius;  // same disc as fill_annulus
+  bool lit = false;
+
+  // dark spans first, then the lit ones, so the colour changes only twice.
+  for (int pass = 0; pass < 2; pass++) {
+    graphics_context_set_fill_color(ctx, pass ? GColorWhite : GColorBlack);
+    for (int dy = -radius; dy <= radius; dy++) {
+      int y = center.y + dy;
+      if (y < clip.origin.y || y >= clip.origin.y + clip.size.h) continue;
+      int w_sq = radius_sq - dy * dy;
+      int w = my_isqrt(w_sq);
+      // the terminator in 1/16 px; pixels whose centre lies strictly past
+      // it, on the sunward side, are lit.
+      int w16 = my_isqrt(w_sq * 256);
+      int t = floor_div16(k * w16 / MY_TRIG_ONE) + 1;
+      if (t < -w) t = -w;
+      if (t > w + 1) t = w + 1;
+      // waxing: [t, w] lit; waning is the mirror image.
+      int lit_x0 = waxing ? t : -w;
+      int lit_x1 = waxing ? w : -t;
+      int dark_x0 = waxing ? -w : -t + 1;
+      int dark_x1 = waxing ? t - 1 : w;
+      if (pass == 0) {
+        if (dark_x0 <= dark_x1) fill_masked_span(ctx, clip, mask, y, center.x + dark_x0, center.x + dark_x1);
+      } else if (lit_x0 <= lit_x1) {
+        fill_masked_span(ctx, clip, mask, y, center.x + lit_x0, center.x + lit_x1);
+        lit = true;
+      }
+    }
+  }
+
+  if (!lit) {
+    fill_masked_annulus(ctx, clip, mask, center, radius, radius);
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <pebble.h>
+
+// A horizontal run of pixels [x0, x1], empty when x0 > x1.
+typedef struct {
+  int8_t x0;
+  int8_t x1;
+} Span;
+
+#define RASTER_SPANS_PER_ROW 2
+
+// A region made of up to two spans on each row of a square of rows
+// -radius..radius around `center'; the x values are relative to center.x.
+typedef struct {
+  GPoint center;
+  int radius;
+  const Span (*rows)[RASTER_SPANS_PER_ROW];
+} SpanMask;
+
+// Fills the region with the current fill color, one rect per span.
+void fill_span_mask(GContext *ctx, GRect clip, const SpanMask *mask);
+
+// Fills the region with `color' by writing the frame buffer directly: the
+// bytes at both ends of a span are masked, the ones in between memset.
+// `layer_origin' is the layer's position on the screen and `clip' is in
+// layer coordinates. Falls back to fill_span_mask if the frame buffer
+// can't be captured.
+void fill_span_mask_direct(GContext *ctx, GPoint layer_origin, GRect clip, const SpanMask *mask, GColor color);
+
+// Fills every pixel whose distance from `center' lies between
+// `inner_radius' and `outer_radius' (inclusive) with the current fill
+// color, one horizontal span per scanline. An `inner_radius' of 0 fills a
+// disc; equal radii give a 1-px ring. Rows and spans outside `clip' are
+// skipped.
+void fill_annulus(GContext *ctx, GRect clip, GPoint center, int inner_radius, int outer_radius);
+
+// Paints a moon of `radius' at `center' for `phase' (0 new, 0.25 first
+// quarter, 0.5 full, 0.75 last quarter): per scanline the lit limb is
+// split from the dark side where the terminator ellipse, x = w * cos(2 pi
+// phase) for a row of half-width w, crosses it. Lit pixels are white and
+// dark ones black; nothing outside the disc is written. When no pixel is
+// lit the limb is drawn white, so a new moon still shows. Waxing moons are
+// lit on the right, as seen from the northern hemisphere. With a `mask',
+// only the pixels inside it are written.
+void fill_moon(GContext *ctx, GRect clip, const SpanMask *mask, GPoint center, int radius, float phase);
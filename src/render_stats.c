@@ -0,0 +1,130 @@
+#define RENDER_STATS_IMPL
+#include "render_stats.h"
+
+#ifdef RENDER_STATS
+
+typedef struct {
+  uint16_t ms[RENDER_STATS_SAMPLES];
+  uint16_t draw_calls[RENDER_STATS_SAMPLES];
+  uint8_t next;
+  uint8_t count;
+} Ring;
+
+typedef struct {
+  Layer *layer;
+  LayerUpdateProc update_proc;
+  const char *name;
+  Ring ring;
+} Slot;
+
+uint16_t render_stats_draw_calls = 0;
+
+static Slot slots[RENDER_STATS_MAX_LAYERS];
+static int slot_count = 0;
+static Ring latency;
+static uint32_t tick_ms = 0;
+static uint16_t pending_latency = 0;
+static bool latency_pending = false;
+
+static uint32_t now_ms(void) {
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return (uint32_t)seconds * 1000 + ms;
+}
+
+static void ring_add(Ring *ring, uint16_t ms, uint16_t draw_calls) {
+  ring->ms[ring->next] = ms;
+  ring->draw_calls[ring->next] = draw_calls;
+  ring->next = (ring->next + 1) % RENDER_STATS_SAMPLES;
+  if (ring->count < RENDER_STATS_SAMPLES) ring->count++;
+}
+
+static void instrumented_update_proc(Layer *layer, GContext *ctx) {
+  Slot *slot = NULL;
+  for (int i = 0; i < slot_count; i++) {
+    if (slots[i].layer == layer) slot = &slots[i];
+  }
+  if (!slot) return;
+
+  render_stats_draw_calls = 0;
+  uint32_t start = now_ms();
+  slot->update_proc(layer, ctx);
+  uint32_t end = now_ms();
+  ring_add(&slot->ring, end - start, render_stats_draw_calls);
+
+  // the last layer painted after a tick ends the frame; redraws long after
+  // it were caused by something else.
+  if (tick_ms && end - tick_ms < 1000) {
+    pending_latency = end - tick_ms;
+    latency_pending = true;
+  }
+}
+
+void render_stats_set_update_proc(Layer *layer, LayerUpdateProc update_proc, const char *name) {
+  for (int i = 0; i < slot_count; i++) {
+    if (slots[i].layer == layer) {
+      slots[i].update_proc = update_proc;
+      return;
+    }
+  }
+  if (slot_count == RENDER_STATS_MAX_LAYERS) {
+    layer_set_update_proc(layer, update_proc);
+    return;
+  }
+  slots[slot_count++] = (Slot) { .layer = layer, .update_proc = update_proc, .name = name };
+  layer_set_update_proc(layer, instrumented_update_proc);
+}
+
+void render_stats_tick(void) {
+  if (latency_pending) {
+    ring_add(&latency, pending_latency, 0);
+    latency_pending = false;
+  }
+  tick_ms = now_ms();
+}
+
+// appends " name min/avg/max" (ms) and the average draw count to `text'.
+static int format_ring(char *text, int size, const char *name, const Ring *ring, bool draws) {
+  if (ring->count == 0) return 0;
+  uint16_t min = UINT16_MAX, max = 0;
+  uint32_t sum = 0, draw_sum = 0;
+  for (int i = 0; i < ring->count; i++) {
+    if (ring->ms[i] < min) min = ring->ms[i];
+    if (ring->ms[i] > max) max = ring->ms[i];
+    sum += ring->ms[i];
+    draw_sum += ring->draw_calls[i];
+  }
+  // "&face_layer_update_proc" -> "face"
+  if (*name == '&') name++;
+  int name_length = strlen(name);
+  const char *suffix = strstr(name, "_layer_update_proc");
+  if (suffix) name_length = suffix - name;
+
+  if (draws) {
+    return snprintf(text, size, "%.*s %u/%u/%u %ud; ", name_length, name, min,
+                    (unsigned)(sum / ring->count), max, (unsigned)(draw_sum / ring->count));
+  }
+  return snprintf(text, size, "%.*s %u/%u/%u; ", name_length, name, min,
+                  (unsigned)(sum / ring->count), max);
+}
+
+void render_stats_send(void) {
+  static char summary[RENDER_STATS_SUMMARY_SIZE];
+  int length = 0;
+  for (int i = 0; i < slot_count && length < (int)sizeof(summary); i++) {
+    length += format_ring(summary + length, sizeof(summary) - length, slots[i].name, &slots[i].ring, true);
+  }
+  if (length < (int)sizeof(summary)) {
+    format_ring(summary + length, sizeof(summary) - length, "latency", &latency, false);
+  }
+
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+  dict_write_cstring(iter, RENDER_STATS_KEY, summary);
+  app_message_outbox_send();
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * Field profiling for the update procs, compiled in only when RENDER_STATS
+ * is defined (build with -DRENDER_STATS, or uncomment the line below).
+ *
+ * Each instrumented layer keeps its last RENDER_STATS_SAMPLES redraws in a
+ * ring: the time spent in its update proc (time_ms resolution), and the
+ * number of drawing primitives it issued. The tick handler stamps the
+ * time so the delay from tick to the last layer painted can be kept too.
+ * A message carrying RENDER_STATS_KEY asks for a summary, which goes back
+ * to the phone as a line of text under the same key. The phone only asks
+ * when request_render_stats is set in src/js/pebble-js-app.js.
+ */
+// #define RENDER_STATS
+
+#define RENDER_STATS_KEY 0x20
+#define RENDER_STATS_SAMPLES 16
+#define RENDER_STATS_MAX_LAYERS 8
+// the summary string, terminator included.
+#define RENDER_STATS_SUMMARY_SIZE (RENDER_STATS_MAX_LAYERS * 32 + 32)
+
+#ifdef RENDER_STATS
+
+// like layer_set_update_proc, but times the proc under `name'.
+void render_stats_set_update_proc(Layer *layer, LayerUpdateProc update_proc, const char *name);
+void render_stats_tick(void);
+void render_stats_send(void);
+
+// counted by every drawing primitive while an instrumented proc is running.
+extern uint16_t render_stats_draw_calls;
+
+#ifndef RENDER_STATS_IMPL
+// count the primitives the face uses without touching the call sites.
+#define graphics_draw_text(...) (render_stats_draw_calls++, graphics_draw_text(__VA_ARGS__))
+#define graphics_draw_circle(...) (render_stats_draw_calls++, graphics_draw_circle(__VA_ARGS__))
+#define graphics_fill_circle(...) (render_stats_draw_calls++, graphics_fill_circle(__VA_ARGS__))
+#define graphics_fill_rect(...) (render_stats_draw_calls++, graphics_fill_rect(__VA_ARGS__))
+#define graphics_draw_bitmap_in_rect(...) (render_stats_draw_calls++, graphics_draw_bitmap_in_rect(__VA_ARGS__))
+#define gpath_draw_filled(...) (render_stats_draw_calls++, gpath_draw_filled(__VA_ARGS__))
+#define gpath_draw_outline(...) (render_stats_draw_calls++, gpath_draw_outline(__VA_ARGS__))
+#endif
+
+#define RENDER_STATS_SET_UPDATE_PROC(layer, proc) render_stats_set_update_proc(layer, proc, #proc)
+#define RENDER_STATS_TICK() render_stats_tick()
+
+#else
+
+#define RENDER_STATS_SET_UPDATE_PROC(layer, proc) layer_set_update_proc(layer, proc)
+#define RENDER_STATS_TICK()
+
+#endif
@@ -0,0 +1,122 @@
+#include "sprite.h"
+#include "render_stats.h"
+
+#define SCREEN_WIDTH 144
+#define SCREEN_HEIGHT 168
+
+static void frame_to_bitmap(GBitmap *fb, GRect frame, GBitmap *bitmap) {
+  uint8_t *src = gbitmap_get_data(fb) + frame.origin.y * gbitmap_get_bytes_per_row(fb) + frame.origin.x / 8;
+  uint8_t *dst = gbitmap_get_data(bitmap);
+  for (int y=0; y<frame.size.h; y++) {
+    memcpy(dst, src, frame.size.w / 8);
+    src += gbitmap_get_bytes_per_row(fb);
+    dst += gbitmap_get_bytes_per_row(bitmap);
+  }
+}
+
+static void frame_fill(GBitmap *fb, GRect frame, uint8_t value) {
+  uint8_t *row = gbitmap_get_data(fb) + frame.origin.y * gbitmap_get_bytes_per_row(fb) + frame.origin.x / 8;
+  for (int y=0; y<frame.size.h; y++) {
+    memset(row, value, frame.size.w / 8);
+    row += gbitmap_get_bytes_per_row(fb);
+  }
+}
+
+static void frame_swap(GBitmap *fb, GRect frame, GBitmap *bitmap) {
+  uint8_t *a = gbitmap_get_data(fb) + frame.origin.y * gbitmap_get_bytes_per_row(fb) + frame.origin.x / 8;
+  uint8_t *b = gbitmap_get_data(bitmap);
+  for (int y=0; y<frame.size.h; y++) {
+    for (int x=0; x<frame.size.w / 8; x++) {
+      uint8_t tmp = a[x];
+      a[x] = b[x];
+      b[x] = tmp;
+    }
+    a += gbitmap_get_bytes_per_row(fb);
+    b += gbitmap_get_bytes_per_row(bitmap);
+  }
+}
+
+bool sprite_init(Sprite *sprite, GRect rect, GPoint layer_origin) {
+  // the masks are copied to and from the frame buffer a byte at a time,
+  // so widen the frame to whole bytes and clip it to the screen.
+  int x0 = layer_origin.x + rect.origin.x;
+  int y0 = layer_origin.y + rect.origin.y;
+  int x1 = x0 + rect.size.w;
+  int y1 = y0 + rect.size.h;
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > SCREEN_WIDTH) x1 = SCREEN_WIDTH;
+  if (y1 > SCREEN_HEIGHT) y1 = SCREEN_HEIGHT;
+  x0 &= ~7;
+  x1 = (x1 + 7) & ~7;
+
+  sprite->frame = GRect(x0, y0, x1 - x0, y1 - y0);
+  sprite->offset = layer_origin;
+  sprite->valid = false;
+  sprite->and_mask = gbitmap_create_blank(sprite->frame.size, GBitmapFormat1Bit);
+  sprite->or_mask = gbitmap_create_blank(sprite->frame.size, GBitmapFormat1Bit);
+  if (!sprite->and_mask || !sprite->or_mask) {
+    sprite_deinit(sprite);
+    return false;
+  }
+  return true;
+}
+
+void sprite_deinit(Sprite *sprite) {
+  if (sprite->and_mask) gbitmap_destroy(sprite->and_mask);
+  if (sprite->or_mask) gbitmap_destroy(sprite->or_mask);
+  sprite->and_mask = NULL;
+  sprite->or_mask = NULL;
+  sprite->valid = false;
+}
+
+void sprite_invalidate(Sprite *sprite) {
+  sprite->valid = false;
+}
+
+bool sprite_render(Sprite *sprite, GContext *ctx, SpriteDrawProc draw, void *data) {
+  sprite->valid = false;
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    return false;
+  }
+  // park whatever the layers below have drawn in `or_mask'; it is
+  // swapped back into the frame buffer once both masks are captured.
+  frame_to_bitmap(fb, sprite->frame, sprite->or_mask);
+  frame_fill(fb, sprite->frame, 0xFF);
+  graphics_release_frame_buffer(ctx, fb);
+  draw(ctx, data);
+
+  // past this point a failed capture has already lost what was parked,
+  // so the caller's fallback draws over a blank frame instead.
+  fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    return false;
+  }
+  frame_to_bitmap(fb, sprite->frame, sprite->and_mask);
+  frame_fill(fb, sprite->frame, 0x00);
+  graphics_release_frame_buffer(ctx, fb);
+  draw(ctx, data);
+
+  fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    return false;
+  }
+  frame_swap(fb, sprite->frame, sprite->or_mask);
+  graphics_release_frame_buffer(ctx, fb);
+
+  sprite->valid = true;
+  return true;
+}
+
+void sprite_draw(Sprite *sprite, GContext *ctx) {
+  GRect rect = sprite->frame;
+  rect.origin.x -= sprite->offset.x;
+  rect.origin.y -= sprite->offset.y;
+
+  graphics_context_set_compositing_mode(ctx, GCompOpAnd);
+  graphics_draw_bitmap_in_rect(ctx, sprite->and_mask, rect);
+  graphics_context_set_compositing_mode(ctx, GCompOpOr);
+  graphics_draw_bitmap_in_rect(ctx, sprite->or_mask, rect);
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+}
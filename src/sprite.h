@@ -0,0 +1,34 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * A sprite is a cached, partly transparent rendering of some drawing code.
+ *
+ * The 1-bit display has no alpha channel, so a sprite is kept as two masks:
+ * - `and_mask' is the drawing rendered over white: black where the drawing
+ *   paints black, white everywhere else.
+ * - `or_mask' is the drawing rendered over black: white where the drawing
+ *   paints white, black everywhere else.
+ * Compositing `and_mask' with GCompOpAnd and then `or_mask' with GCompOpOr
+ * reproduces the drawing exactly while leaving unpainted pixels alone.
+ */
+typedef void (*SpriteDrawProc)(GContext *ctx, void *data);
+
+typedef struct {
+  GBitmap *and_mask;
+  GBitmap *or_mask;
+  GRect frame;     // byte-aligned, in screen coordinates
+  GPoint offset;   // screen origin of the layer the sprite was rendered in
+  bool valid;
+} Sprite;
+
+// `rect' is in the coordinates of the layer being drawn; `layer_origin' is
+// that layer's position on the screen.
+bool sprite_init(Sprite *sprite, GRect rect, GPoint layer_origin);
+void sprite_deinit(Sprite *sprite);
+void sprite_invalidate(Sprite *sprite);
+// must be called from inside the update proc of the layer the sprite belongs
+// to. Returns false, leaving the sprite invalid, when the frame buffer can't
+// be captured; the caller should then draw directly instead of sprite_draw.
+bool sprite_render(Sprite *sprite, GContext *ctx, SpriteDrawProc draw, void *data);
+void sprite_draw(Sprite *sprite, GContext *ctx);
@@ -0,0 +1,94 @@
+#include "sun_table.h"
+#include "my_math.h"
+
+// a table computed further away than this (in degrees) is considered stale.
+#define SUN_TABLE_MAX_DRIFT 0.25f
+
+#define SUN_TABLE_CHUNKS (SUN_TABLE_MAX_ROWS / SUN_TABLE_ROWS_PER_CHUNK)
+
+typedef struct {
+  int32_t start_day;
+  int32_t count;
+  float latitude;
+  float longitude;
+  uint32_t chunks_received;  // bit n set once chunk n is persisted
+} SunTableHeader;
+
+static SunTableHeader header;
+static bool header_loaded = false;
+
+static void load_header(void) {
+  if (header_loaded) {
+    return;
+  }
+  if (persist_read_data(SUN_TABLE_PERSIST_HEADER, &header, sizeof(header)) != sizeof(header)) {
+    memset(&header, 0, sizeof(header));
+  }
+  header_loaded = true;
+}
+
+int32_t days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int yoe = year - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+void sun_table_receive(int32_t start_day, int32_t offset, int32_t count,
+		       const uint8_t *data, uint16_t length,
+		       float latitude, float longitude) {
+  load_header();
+  int chunk = offset / SUN_TABLE_ROWS_PER_CHUNK;
+  if (offset % SUN_TABLE_ROWS_PER_CHUNK || chunk >= SUN_TABLE_CHUNKS || length > SUN_TABLE_CHUNK_SIZE) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Sun table: bad chunk at row %d.", (int) offset);
+    return;
+  }
+
+  if (header.start_day != start_day || header.latitude != latitude || header.longitude != longitude) {
+    // a new table; forget about the chunks of the old one.
+    header.start_day = start_day;
+    header.latitude = latitude;
+    header.longitude = longitude;
+    header.chunks_received = 0;
+  }
+  header.count = (count > SUN_TABLE_MAX_ROWS) ? SUN_TABLE_MAX_ROWS : count;
+
+  persist_write_data(SUN_TABLE_PERSIST_CHUNK + chunk, data, length);
+  header.chunks_received |= 1u << chunk;
+  persist_write_data(SUN_TABLE_PERSIST_HEADER, &header, sizeof(header));
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Sun table: stored rows %d-%d.", (int) offset, (int) (offset + length / SUN_TABLE_ROW_SIZE - 1));
+}
+
+static float row_hours(const uint8_t *p) {
+  uint16_t minutes = p[0] | (p[1] << 8);
+  // calcSun reports "no sunrise/sunset" as 0 as well.
+  return (minutes == SUN_TABLE_NO_EVENT) ? 0 : minutes / 60.0f;
+}
+
+bool sun_table_lookup(int32_t day, float latitude, float longitude, float *sunrise, float *sunset) {
+  load_header();
+  int32_t row = day - header.start_day;
+  if (row < 0 || row >= header.count) {
+    return false;
+  }
+  if (my_fabs(header.latitude - latitude) > SUN_TABLE_MAX_DRIFT ||
+      my_fabs(header.longitude - longitude) > SUN_TABLE_MAX_DRIFT) {
+    return false;
+  }
+  int chunk = row / SUN_TABLE_ROWS_PER_CHUNK;
+  if (!(header.chunks_received & (1u << chunk))) {
+    return false;
+  }
+
+  uint8_t data[SUN_TABLE_CHUNK_SIZE];
+  int size = persist_read_data(SUN_TABLE_PERSIST_CHUNK + chunk, data, sizeof(data));
+  int index = (row % SUN_TABLE_ROWS_PER_CHUNK) * SUN_TABLE_ROW_SIZE;
+  if (index + SUN_TABLE_ROW_SIZE > size) {
+    return false;
+  }
+  *sunrise = row_hours(&data[index]);
+  *sunset = row_hours(&data[index + 2]);
+  return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * Sunrise/sunset table computed by the phone for the coming days.
+ *
+ * Each row is two little-endian uint16 values, sunrise and sunset in
+ * minutes after 00:00 UT (SUN_TABLE_NO_EVENT when the sun does not rise or
+ * set that day). The phone sends SUN_TABLE_ROWS_PER_CHUNK rows per
+ * AppMessage, and each chunk is persisted under its own key.
+ */
+#define SUN_TABLE_MAX_ROWS 384
+#define SUN_TABLE_ROWS_PER_CHUNK 64
+#define SUN_TABLE_ROW_SIZE 4
+#define SUN_TABLE_CHUNK_SIZE (SUN_TABLE_ROWS_PER_CHUNK * SUN_TABLE_ROW_SIZE)
+#define SUN_TABLE_NO_EVENT 0xFFFF
+
+// persist keys; chunk n is stored under SUN_TABLE_PERSIST_CHUNK + n.
+#define SUN_TABLE_PERSIST_HEADER 0x20
+#define SUN_TABLE_PERSIST_CHUNK 0x21
+
+// days since 1970-01-01 of the given civil date.
+int32_t days_from_civil(int year, int month, int day);
+
+// stores one chunk; `latitude'/`longitude' are the location it was computed for.
+void sun_table_receive(int32_t start_day, int32_t offset, int32_t count,
+		       const uint8_t *data, uint16_t length,
+		       float latitude, float longitude);
+// fills in UT hours for `day' if the table covers it and was computed for
+// (roughly) this location.
+bool sun_table_lookup(int32_t day, float latitude, float longitude, float *sunrise, float *sunset);
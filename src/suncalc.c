@@ -5,15 +5,28 @@
 #include "suncalc.h"
 #include "my_math.h"
 
-float calcSun(int year, int month, int day, float latitude, float longitude, int sunset, float zenith)
+#ifndef SUNCALC_FIXED_POINT
+
+// the day-of-year `N' of the Almanac algorithm.
+static int day_number(int year, int month, int day)
 {
   int N1 = my_floor(275 * month / 9);
   int N2 = my_floor((month + 9) / 12);
   int N3 = (1 + my_floor((year - 4 * my_floor(year / 4) + 2) / 3));
-  int N = N1 - (N2 * N3) + day - 30;
+  return N1 - (N2 * N3) + day - 30;
+}
 
-  float lngHour = longitude / 15;
-  
+// steps 2-6: everything about the sun's position at the approximate
+// time of the event, which every zenith shares.
+typedef struct {
+  float t;
+  float RA;      // hours
+  float sinDec;
+  float cosDec;
+} SolarTerms;
+
+static void solar_terms(int N, float lngHour, int sunset, SolarTerms *terms)
+{
   float t;
   if (!sunset)
   {
@@ -52,17 +65,30 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
   float sinDec = 0.39782 * my_sin((M_PI/180.0f) * L);
   float cosDec = my_cos(my_asin(sinDec));
 
+  terms->t = t;
+  terms->RA = RA;
+  terms->sinDec = sinDec;
+  terms->cosDec = cosDec;
+}
+
+// steps 7-9 for one zenith; `sin_lat'/`cos_lat' are of the latitude.
+static float solve(const SolarTerms *terms, float lngHour, float sin_lat, float cos_lat,
+		   float zenith, int sunset, uint8_t *polar)
+{
   //7a. calculate the Sun's local hour angle
   //cosH = (cos(zenith) - (sinDec * sin(latitude))) / (cosDec * cos(latitude))
-  float cosH = (my_cos((M_PI/180.0f) * zenith) - (sinDec * my_sin((M_PI/180.0f) * latitude))) / (cosDec * my_cos((M_PI/180.0f) * latitude));
+  float cosH = (my_cos((M_PI/180.0f) * zenith) - (terms->sinDec * sin_lat)) / (terms->cosDec * cos_lat);
   
   if (cosH >  1) {
+    *polar = SUNCALC_ALWAYS_BELOW;
     return 0;
   }
   else if (cosH < -1)
   {
+    *polar = SUNCALC_ALWAYS_ABOVE;
     return 0;
   }
+  *polar = SUNCALC_CROSSES;
     
   //7b. finish calculating H and convert into hours
   
@@ -81,7 +107,7 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
   H = H / 15;
 
   //8. calculate local mean time of rising/setting
-  float T = H + RA - (0.06571 * t) - 6.622;
+  float T = H + terms->RA - (0.06571 * terms->t) - 6.622;
 
   //9. adjust back to UTC
   float UT = T - lngHour;
@@ -91,6 +117,193 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
   return UT;
 }
 
+static float longitude_hours(float longitude)
+{
+  return longitude / 15;
+}
+
+static float sin_latitude(float latitude)
+{
+  return my_sin((M_PI/180.0f) * latitude);
+}
+
+static float cos_latitude(float latitude)
+{
+  return my_cos((M_PI/180.0f) * latitude);
+}
+
+#else /* SUNCALC_FIXED_POINT */
+
+/*
+ * The same algorithm in Q16.16 fixed point, with angles in
+ * MY_TRIG_MAX_ANGLE units (the same as Pebble's TRIG_MAX_ANGLE) and the
+ * trig done by my_math's lookup tables. The only float operations left
+ * are the conversion of the arguments and of the result.
+ */
+#define TRIG_MAX_ANGLE MY_TRIG_MAX_ANGLE
+#define FIX_ONE MY_TRIG_ONE
+#define FIX(x) ((int32_t)((x) * FIX_ONE))
+#define ANGLE_PER_DEG (TRIG_MAX_ANGLE / 360.0)
+#define DEG_TO_ANGLE(x) ((int32_t)((x) * ANGLE_PER_DEG))
+
+static int32_t fix_mul(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a * b) >> 16);
+}
+
+static int32_t fix_div(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a << 16) / b);
+}
+
+// sqrt(1 - x*x) for x in [-1, 1]
+static int32_t fix_cos_from_sin(int32_t x)
+{
+  int32_t r = FIX_ONE - fix_mul(x, x);
+  if (r <= 0) return 0;
+  if (r >= FIX_ONE) return FIX_ONE;
+  return my_isqrt((uint32_t)r << 16);
+}
+
+static int day_number(int year, int month, int day)
+{
+  int N1 = 275 * month / 9;
+  int N2 = (month + 9) / 12;
+  int N3 = 1 + ((year % 4) + 2) / 3;
+  return N1 - (N2 * N3) + day - 30;
+}
+
+typedef struct {
+  int32_t t;       // Q16 days
+  int32_t RA;      // Q16 hours
+  int32_t sinDec;
+  int32_t cosDec;
+} SolarTerms;
+
+// longitude in Q16 hours
+static int32_t longitude_hours(float longitude)
+{
+  return (int32_t)(longitude * (FIX_ONE / 15.0f));
+}
+
+static int32_t latitude_angle(float latitude)
+{
+  return (int32_t)(latitude * (float)ANGLE_PER_DEG);
+}
+
+static int32_t sin_latitude(float latitude)
+{
+  return my_sin_lookup(latitude_angle(latitude));
+}
+
+static int32_t cos_latitude(float latitude)
+{
+  return my_cos_lookup(latitude_angle(latitude));
+}
+
+static void solar_terms(int N, int32_t lngHour, int sunset, SolarTerms *terms)
+{
+  // t, in Q16 days
+  int32_t t = (N << 16) + (((sunset ? 18 : 6) << 16) - lngHour) / 24;
+
+  // M = 0.9856 t - 3.289 degrees, as an angle
+  int32_t M = (int32_t)(((int64_t)t * FIX(0.9856 * ANGLE_PER_DEG)) >> 32) - DEG_TO_ANGLE(3.289);
+
+  //calculate the Sun's true longitude
+  //L = M + (1.916 * sin(M)) + (0.020 * sin(2 * M)) + 282.634
+  int32_t L = M
+    + (int32_t)(((int64_t)FIX(1.916 * ANGLE_PER_DEG) * my_sin_lookup(M & (TRIG_MAX_ANGLE - 1))) >> 32)
+    + (int32_t)(((int64_t)FIX(0.020 * ANGLE_PER_DEG) * my_sin_lookup((2 * M) & (TRIG_MAX_ANGLE - 1))) >> 32)
+    + DEG_TO_ANGLE(282.634);
+  L &= TRIG_MAX_ANGLE - 1;
+  int32_t sinL = my_sin_lookup(L);
+  int32_t cosL = my_cos_lookup(L);
+
+  //5. right ascension; atan2 keeps it in the same quadrant as L
+  terms->RA = my_atan2_lookup(fix_mul(FIX(0.91764), sinL), cosL) * 24;  // Q16 hours
+
+  //6. calculate the Sun's declination
+  terms->sinDec = fix_mul(FIX(0.39782), sinL);
+  terms->cosDec = fix_cos_from_sin(terms->sinDec);
+  terms->t = t;
+}
+
+static float solve(const SolarTerms *terms, int32_t lngHour, int32_t sin_lat, int32_t cos_lat,
+		   float zenith, int sunset, uint8_t *polar)
+{
+  int32_t zen = (int32_t)(zenith * (float)ANGLE_PER_DEG);
+
+  //7a. calculate the Sun's local hour angle
+  *polar = SUNCALC_CROSSES;
+  int32_t numerator = my_cos_lookup(zen) - fix_mul(terms->sinDec, sin_lat);
+  int32_t denominator = fix_mul(terms->cosDec, cos_lat);
+  if (denominator == 0) {
+    // at a pole the sun stays at one height all day; cosH is +/- infinity.
+    *polar = (numerator > 0) ? SUNCALC_ALWAYS_BELOW : SUNCALC_ALWAYS_ABOVE;
+    return 0;
+  }
+  int32_t cosH = fix_div(numerator, denominator);
+  if (cosH > FIX_ONE) {
+    *polar = SUNCALC_ALWAYS_BELOW;
+    return 0;
+  }
+  if (cosH < -FIX_ONE) {
+    *polar = SUNCALC_ALWAYS_ABOVE;
+    return 0;
+  }
+
+  //7b. finish calculating H and convert into hours
+  int32_t H = my_acos_lookup(cosH);
+  if (!sunset) {
+    H = TRIG_MAX_ANGLE - H;
+  }
+  H *= 24;  // Q16 hours
+
+  //8. calculate local mean time of rising/setting
+  int32_t T = H + terms->RA - fix_mul(FIX(0.06571), terms->t) - FIX(6.622);
+
+  //9. adjust back to UTC
+  int32_t UT = T - lngHour;
+  while (UT < 0) UT += 24 * FIX_ONE;
+  while (UT > 24 * FIX_ONE) UT -= 24 * FIX_ONE;
+
+  return UT * (1.0f / FIX_ONE);
+}
+
+#endif /* SUNCALC_FIXED_POINT */
+
+float calcSun(int year, int month, int day, float latitude, float longitude, int sunset, float zenith)
+{
+  SolarTerms terms;
+  uint8_t polar;
+  solar_terms(day_number(year, month, day), longitude_hours(longitude), sunset, &terms);
+  return solve(&terms, longitude_hours(longitude), sin_latitude(latitude), cos_latitude(latitude),
+	       zenith, sunset, &polar);
+}
+
+// the expensive part of the algorithm, the sun's position, only depends
+// on the day and on whether it is the morning or the evening event; each
+// extra zenith just costs the hour angle.
+void calcSunEvents(int year, int month, int day, float latitude, float longitude,
+		   const float *zeniths, int count, SunEvents *events)
+{
+  int N = day_number(year, month, day);
+  SolarTerms rise, set;
+  solar_terms(N, longitude_hours(longitude), 0, &rise);
+  solar_terms(N, longitude_hours(longitude), 1, &set);
+
+  for (int i = 0; i < count && i < SUNCALC_MAX_ZENITHS; i++) {
+    uint8_t rise_polar, set_polar;
+    events->rise[i] = solve(&rise, longitude_hours(longitude), sin_latitude(latitude), cos_latitude(latitude),
+			    zeniths[i], 0, &rise_polar);
+    events->set[i] = solve(&set, longitude_hours(longitude), sin_latitude(latitude), cos_latitude(latitude),
+			   zeniths[i], 1, &set_polar);
+    // the two epochs are half a day apart and can disagree right at the
+    // edge of the polar day or night; the morning wins.
+    events->polar[i] = (rise_polar != SUNCALC_CROSSES) ? rise_polar : set_polar;
+  }
+}
+
 float calcSunRise(int year, int month, int day, float latitude, float longitude, float zenith)
 {
   return calcSun(year, month, day, latitude, longitude, 0, zenith);
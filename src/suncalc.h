@@ -1,8 +1,34 @@
+#pragma once
+#include <stdint.h>
+
 #define ZENITH_OFFICIAL 90.83
 #define ZENITH_CIVIL    96.0
 #define ZENITH_NAUTICAL 102.0
 #define ZENITH_ASTRONOMICAL 108.0
 
+// build with -DSUNCALC_FIXED_POINT to use the integer-only calcSun.
+
 float calcSun(int year, int month, int day, float latitude, float longitude, int sunset, float zenith);
 float calcSunRise(int year, int month, int day, float latitude, float longitude, float zenith);
-float calcSunSet(int year, int month, int day, float latitude, float longitude, float zenith);
\ No newline at end of file
+float calcSunSet(int year, int month, int day, float latitude, float longitude, float zenith);
+
+// what calcSunEvents reports for a zenith the sun does not cross that day.
+enum {
+  SUNCALC_CROSSES = 0,
+  SUNCALC_ALWAYS_ABOVE,    // e.g. midnight sun, or white nights for the twilights
+  SUNCALC_ALWAYS_BELOW,    // e.g. polar night
+};
+
+#define SUNCALC_MAX_ZENITHS 4
+
+typedef struct {
+  float rise[SUNCALC_MAX_ZENITHS];   // UT hours, as calcSunRise (0 when polar)
+  float set[SUNCALC_MAX_ZENITHS];    // UT hours, as calcSunSet
+  uint8_t polar[SUNCALC_MAX_ZENITHS];
+} SunEvents;
+
+// rise and set for up to SUNCALC_MAX_ZENITHS zeniths at once, at about the
+// cost of one calcSunRise/calcSunSet pair; each result is the same as the
+// single-zenith call would return.
+void calcSunEvents(int year, int month, int day, float latitude, float longitude,
+		   const float *zeniths, int count, SunEvents *events);
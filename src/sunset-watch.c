@@ -1,27 +1,47 @@
 #include <pebble.h>
 #include "my_math.h"
 #include "suncalc.h"
+#include "sprite.h"
+#include "dial_layout.h"
+#include "raster.h"
+#include "ephemeris.h"
+#include "sun_table.h"
+#include "city_table.h"
+#include "tz_schedule.h"
+#include "render_stats.h"
+#include "label.h"
 
 static Window *window;
 static Layer *face_layer;
 static Layer *hand_layer;
 static Layer *sunlight_layer;
 static Layer *sunrise_sunset_text_layer;
+static Layer *time_text_layer;
+static Layer *date_text_layer;
 static Layer *moon_layer;
 static Layer *battery_layer;
-int current_sunrise_sunset_day = -1;
-int current_moon_day = -1;
-float sunriseTime;
-float sunsetTime;
-int phase;
+static Sprite dial_sprite;
+// created once in window_load; the update procs only move and rotate them.
+static GPath *hour_hand_path;
+static GPath *second_hand_path;
+// pre-rendered text; the strings are only formatted when they can change.
+static Label time_label;
+static Label month_label;
+static Label day_label;
+static Label sunrise_label;
+static Label sunset_label;
+static Label battery_label;
+static AppTimer *day_event_timer = NULL;
+static AppTimer *glance_timer = NULL;
 double lat;
 double lon;
 double tz;
 bool position = false;
 int current_battery_charge = -1;
-char *battery_level_string = "100%";
+char battery_level_string[] = "100%";
 
 bool setting_second_hand = false;
+int  setting_glance_seconds = 0;  // 0: the second hand always runs
 bool setting_digital_display = true;
 bool setting_hour_numbers = true;
 bool setting_moon_phase = true;
@@ -29,90 +49,104 @@ bool setting_battery_status = true;
 bool setting_daylight_savings = false;
 bool setting_manual_timezone = false;
 int  setting_manual_offset = -7;
-/* bool setting_manual_location = false; */
-/* double setting_manual_latitude = -111.0; */
-/* double setting_manual_longitude = 38.0; */
-
-// Since compilation fails using the standard `atof',
-// the following `myatof' implementation taken from:
-// 09-May-2009 Tom Van Baak (tvb) www.LeapSecond.com
-// 
-#define white_space(c) ((c) == ' ' || (c) == '\t')
-#define valid_digit(c) ((c) >= '0' && (c) <= '9')
-double myatof (const char *p)
-{
-    int frac;
-    double sign, value, scale;
-    // Skip leading white space, if any.
-    while (white_space(*p) ) {
-        p += 1;
-    }
-    // Get sign, if any.
-    sign = 1.0;
-     if (*p == '-') {
-        sign = -1.0;
-        p += 1;
-    } else if (*p == '+') {
-        p += 1;
-    }
-    // Get digits before decimal point or exponent, if any.
-    for (value = 0.0; valid_digit(*p); p += 1) {
-        value = value * 10.0 + (*p - '0');
-    }
-    // Get digits after decimal point, if any.
-    if (*p == '.') {
-        double pow10 = 10.0;
-        p += 1;
-        while (valid_digit(*p)) {
-            value += (*p - '0') / pow10;
-            pow10 *= 10.0;
-            p += 1;
-        }
-    }
-    // Handle exponent, if any.
-    frac = 0;
-    scale = 1.0;
-    if ((*p == 'e') || (*p == 'E')) {
-        unsigned int expon;
-        // Get sign of exponent, if any.
-        p += 1;
-        if (*p == '-') {
-            frac = 1;
-            p += 1;
-
-        } else if (*p == '+') {
-            p += 1;
-        }
-        // Get digits of exponent, if any.
-        for (expon = 0; valid_digit(*p); p += 1) {
-            expon = expon * 10 + (*p - '0');
-        }
-         if (expon > 308) expon = 308;
-        // Calculate scaling factor.
-        while (expon >= 50) { scale *= 1E50; expon -= 50; }
-        while (expon >=  8) { scale *= 1E8;  expon -=  8; }
-        while (expon >   0) { scale *= 10.0; expon -=  1; }
-    }
-    // Return signed and scaled floating point result.
-    return sign * (frac ? (value / scale) : (value * scale));
-}
+int  setting_city = CITY_NONE;  // manual location, see city_table.h
+
+static void update_daily_state(void);
+static void schedule_day_event(void);
 
 double round(double number)
 {
     return (number >= 0) ? (int)(number + 0.5) : (int)(number - 0.5);
 }
 
+static char *current_time_format(void) {
+  return clock_is_24h_style() ? "%H:%M" : "%l:%M";
+}
+
+static void update_time_label(struct tm *now) {
+  char text[LABEL_MAX_TEXT];
+  strftime(text, sizeof(text), current_time_format(), now);
+  label_set_text(&time_label, text);
+}
+
+// returns true when either label changed.
+static bool update_date_labels(struct tm *now) {
+  char text[LABEL_MAX_TEXT];
+  strftime(text, sizeof(text), "%b", now);
+  bool changed = label_set_text(&month_label, text);
+  strftime(text, sizeof(text), "%e", now);
+  return label_set_text(&day_label, text) || changed;
+}
+
+// only mark the layers whose content depends on the units that changed;
+// the dial itself is cached and never needs to be invalidated by time, and
+// everything that changes by the day is left to the day event timer.
 static void handle_time_tick(struct tm *tick_time, TimeUnits units_changed) {
-  layer_mark_dirty(face_layer);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Tick: marking face_layer dirty...");
+  RENDER_STATS_TICK();
+  layer_mark_dirty(hand_layer);
+  if (units_changed & MINUTE_UNIT) {
+    update_time_label(tick_time);
+    layer_mark_dirty(time_text_layer);
+  }
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Tick: marking layers dirty...");
+}
+
+// in glance mode the second hand only runs for a while after a tap.
+static bool second_hand_visible(void) {
+  return setting_second_hand && (setting_glance_seconds == 0 || glance_timer != NULL);
+}
+
+// ticks every second only while the second hand is showing, and listens
+// for taps only in glance mode.
+static void update_tick_subscription(void) {
+  // in minute mode the time text is new on every frame, so caching it
+  // would only add the sprite's render and blits to each one.
+  label_set_cached(&time_label, second_hand_visible());
+  tick_timer_service_unsubscribe();
+  tick_timer_service_subscribe(second_hand_visible() ? SECOND_UNIT : MINUTE_UNIT, handle_time_tick);
+}
+
+static void glance_timeout(void *data) {
+  glance_timer = NULL;
+  update_tick_subscription();
+  layer_mark_dirty(hand_layer);
+}
+
+static void handle_tap(AccelAxisType axis, int32_t direction) {
+  if (!setting_second_hand || setting_glance_seconds == 0) {
+    return;
+  }
+  if (glance_timer) {
+    app_timer_reschedule(glance_timer, setting_glance_seconds * 1000);
+    return;
+  }
+  glance_timer = app_timer_register(setting_glance_seconds * 1000, glance_timeout, NULL);
+  update_tick_subscription();
+  layer_mark_dirty(hand_layer);
+}
+
+static void update_glance_mode(void) {
+  accel_tap_service_unsubscribe();
+  if (setting_second_hand && setting_glance_seconds > 0) {
+    accel_tap_service_subscribe(handle_tap);
+  } else if (glance_timer) {
+    app_timer_cancel(glance_timer);
+    glance_timer = NULL;
+  }
+  update_tick_subscription();
 }
 
 /******************
   APPMESSAGE STUFF
 *******************/
+// Every message from the phone carries PROTOCOL; anything sent with a
+// different version is ignored rather than misread. Positions are int32
+// micro-degrees and the on/off settings travel as one FLAGS bitfield (see
+// src/js/pebble-js-app.js).
+#define PROTOCOL_VERSION 1
+
 enum {
-  LAT = 0x1,
-  LON = 0X2,
+  // the per-setting keys are only used for persistent storage now.
   SH = 0x3,
   DD = 0x4,
   HN = 0x5,
@@ -121,89 +155,248 @@ enum {
   DS = 0x8,
   MT = 0x9,
   MO = 0xA,
-  /* ML = 0xB, */
-  /* MLAT = 0xC, */
-  /* MLON = 0xD */
+  GS = 0x12,
+  SUN_TABLE_START = 0xE,
+  SUN_TABLE_OFFSET = 0xF,
+  SUN_TABLE_COUNT = 0x10,
+  SUN_TABLE_DATA = 0x11,
+  PROTOCOL = 0x13,
+  LAT_E6 = 0x14,
+  LON_E6 = 0x15,
+  FLAGS = 0x16,
+  POSITION = 0x17,  // persist only: the last SavedPosition
+  CITY = 0x18,
+  UTC_OFFSET = 0x19,
+  TZ_TRANSITIONS = 0x1A,
 };
 
-void in_received_handler(DictionaryIterator *received, void *ctx) {
-  Tuple *latitude = dict_find(received, LAT);
-  Tuple *longitude = dict_find(received, LON);
-  Tuple *second_hand = dict_find(received, SH);
-  Tuple *digital_display = dict_find(received, DD);
-  Tuple *hour_numbers = dict_find(received, HN);
-  Tuple *moon_phase = dict_find(received, MP);
-  Tuple *battery_status = dict_find(received, BS);
-  Tuple *daylight_savings = dict_find(received, DS);
-  Tuple *manual_timezone = dict_find(received, MT);
-  Tuple *manual_offset = dict_find(received, MO);
-  /* Tuple *manual_location = dict_find(received, ML); */
-  /* Tuple *manual_latitude = dict_find(received, MLAT); */
-  /* Tuple *manual_longitude = dict_find(received, MLON); */
+// bits of FLAGS.
+enum {
+  FLAG_SECOND_HAND = 1 << 0,
+  FLAG_DIGITAL_DISPLAY = 1 << 1,
+  FLAG_HOUR_NUMBERS = 1 << 2,
+  FLAG_MOON_PHASE = 1 << 3,
+  FLAG_BATTERY_STATUS = 1 << 4,
+  FLAG_DAYLIGHT_SAVINGS = 1 << 5,
+  FLAG_MANUAL_TIMEZONE = 1 << 6,
+};
 
-  if (latitude && longitude) {
-    lat = myatof(latitude->value->cstring);
-    lon = myatof(longitude->value->cstring);
+// the phone sends integers as int32. The largest message is a sun table
+// chunk; the only thing the watch ever sends is the RENDER_STATS summary.
+#define INBOX_SIZE dict_calc_buffer_size(5, 4, 4, 4, 4, SUN_TABLE_CHUNK_SIZE)
+#ifdef RENDER_STATS
+#define OUTBOX_SIZE dict_calc_buffer_size(1, RENDER_STATS_SUMMARY_SIZE)
+#else
+#define OUTBOX_SIZE dict_calc_buffer_size(1, 4)
+#endif
+
+// a fix closer than this (in micro-degrees, about a kilometre) to the
+// position we have moves sunrise and sunset by a few seconds at most, so it
+// is only noted, not redrawn.
+#define POSITION_MIN_MOVE_E6 10000
+
+// the last position from the phone, kept so a cold start can draw the
+// wedge and moon before (or without) the phone answering.
+typedef struct {
+  int32_t latitude_e6;
+  int32_t longitude_e6;
+  uint32_t time;  // when it was last confirmed
+} SavedPosition;
+
+static SavedPosition saved_position;
+static bool saved_position_valid = false;
+// the manual city, if setting_city is one the table has.
+static City city;
+static bool city_found = false;
+
+// a manual city wins over the phone; its fixes are still saved, so
+// switching back needs no new one.
+static void update_location(void) {
+  if (city_found) {
+    lat = city.latitude_e6 / 1000000.0;
+    lon = city.longitude_e6 / 1000000.0;
     position = true;
-
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Watch received: %s.", latitude->value->cstring);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Watch received: %s.", longitude->value->cstring);
-
-    // without marking one of the layers dirty,
-    // we have to wait until the next tick_event
-    // to see the new masks.
-    layer_mark_dirty(face_layer);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Redrawing...");
+  } else if (saved_position_valid) {
+    lat = saved_position.latitude_e6 / 1000000.0;
+    lon = saved_position.longitude_e6 / 1000000.0;
+    position = true;
+  } else {
+    position = false;
   }
+}
 
-  if (manual_timezone && manual_offset) {
-    setting_manual_timezone = (manual_timezone->value->uint32  == 1) ? true : false;
-    setting_manual_offset = manual_offset->value->int32;
-    APP_LOG(APP_LOG_LEVEL_DEBUG, (setting_manual_timezone) ? "MT: true" : "MT: false");
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "MO: %d", setting_manual_offset);
+static void select_city(int id) {
+  setting_city = id;
+  city_found = (id != CITY_NONE) && city_table_lookup(id, &city);
+  if (id != CITY_NONE && !city_found) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "No city %d; using the phone's location.", id);
   }
+  update_location();
+}
 
-  /* if (manual_location && manual_latitude && manual_longitude) { */
-  /*   setting_manual_location = (manual_location->value->uint32  == 1) ? true : false; */
-  /*   setting_manual_latitude = myatof(manual_latitude->value->cstring); */
-  /*   setting_manual_longitude = myatof(manual_longitude->value->cstring); */
-  /*   APP_LOG(APP_LOG_LEVEL_DEBUG, (setting_manual_location) ? "ML: true" : "ML: false"); */
-  /*   APP_LOG(APP_LOG_LEVEL_DEBUG, "MLAT: %s", manual_latitude->value->cstring); */
-  /*   APP_LOG(APP_LOG_LEVEL_DEBUG, "MLON: %s", manual_longitude->value->cstring); */
-  /* } */
+static void receive_position(int32_t latitude_e6, int32_t longitude_e6) {
+  bool moved = !saved_position_valid ||
+    abs(latitude_e6 - saved_position.latitude_e6) > POSITION_MIN_MOVE_E6 ||
+    abs(longitude_e6 - saved_position.longitude_e6) > POSITION_MIN_MOVE_E6;
+  if (moved) {
+    saved_position.latitude_e6 = latitude_e6;
+    saved_position.longitude_e6 = longitude_e6;
+    saved_position_valid = true;
+    update_location();
+  }
+  saved_position.time = time(NULL);
+  persist_write_data(POSITION, &saved_position, sizeof(saved_position));
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Watch received: %d, %d (micro-degrees)%s.",
+	  (int) latitude_e6, (int) longitude_e6, moved ? "" : ", not moved");
+}
 
-  if (second_hand && digital_display &&
-      hour_numbers && moon_phase && battery_status && daylight_savings) {
-    setting_second_hand = (second_hand->value->uint32 == 1) ? true : false;
-    setting_digital_display = (digital_display->value->uint32 == 1) ? true : false;
-    setting_hour_numbers = (hour_numbers->value->uint32  == 1) ? true : false;
-    setting_moon_phase = (moon_phase->value->uint32 == 1) ? true : false;
-    setting_battery_status = (battery_status->value->uint32  == 1) ? true : false;
-    setting_daylight_savings = (daylight_savings->value->uint32  == 1) ? true : false;
+static void restore_position(void) {
+  if (persist_read_data(POSITION, &saved_position, sizeof(saved_position)) == sizeof(saved_position)) {
+    saved_position_valid = true;
+    update_location();
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Restored position from %d s ago.",
+	    (int) (time(NULL) - saved_position.time));
   }
+}
 
+// the offset used when the phone hasn't sent its own (see
+// current_utc_offset), or when a manual timezone overrides it.
+static void update_timezone(void) {
   // check if a manual timezone is configured; set it if it is.
   if (setting_manual_timezone) {
     tz = (double) setting_manual_offset;
     APP_LOG(APP_LOG_LEVEL_DEBUG, "TZ (manual): %d.", (int) tz);
+  } else if (city_found) {
+    tz = city.utc_offset / 60.0;
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "TZ (city): %d min.", city.utc_offset);
   } else {
     // this is really rough... don't know how well it will actually work
     // in different parts of the world...
     tz = round((lon * 24) / 360);
     APP_LOG(APP_LOG_LEVEL_DEBUG, "TZ (auto): %d.", (int) tz);
   }
+}
 
-  // next line forces recalculation of sunrise/sunset times (in case DS/TZ option is changed).
-  current_sunrise_sunset_day = -1;
+void in_received_handler(DictionaryIterator *received, void *ctx) {
+  Tuple *protocol = NULL;
+  Tuple *latitude = NULL;
+  Tuple *longitude = NULL;
+  Tuple *flags = NULL;
+  Tuple *manual_offset = NULL;
+  Tuple *glance_seconds = NULL;
+  Tuple *city_id = NULL;
+  Tuple *utc_offset = NULL;
+  Tuple *tz_transitions = NULL;
+  Tuple *sun_table_start = NULL;
+  Tuple *sun_table_offset = NULL;
+  Tuple *sun_table_count = NULL;
+  Tuple *sun_table_data = NULL;
+  bool render_stats_request = false;
+
+  // one pass over the message instead of a dict_find per key.
+  for (Tuple *t = dict_read_first(received); t; t = dict_read_next(received)) {
+    switch (t->key) {
+      case PROTOCOL: protocol = t; break;
+      case LAT_E6: latitude = t; break;
+      case LON_E6: longitude = t; break;
+      case FLAGS: flags = t; break;
+      case MO: manual_offset = t; break;
+      case GS: glance_seconds = t; break;
+      case CITY: city_id = t; break;
+      case UTC_OFFSET: utc_offset = t; break;
+      case TZ_TRANSITIONS: tz_transitions = t; break;
+      case SUN_TABLE_START: sun_table_start = t; break;
+      case SUN_TABLE_OFFSET: sun_table_offset = t; break;
+      case SUN_TABLE_COUNT: sun_table_count = t; break;
+      case SUN_TABLE_DATA: sun_table_data = t; break;
+      case RENDER_STATS_KEY: render_stats_request = true; break;
+    }
+  }
 
-  // if the second hand is enabled, we need to make sure the face updates on the appropriate tick event.
-  if (setting_second_hand) {
-    tick_timer_service_unsubscribe();
-    tick_timer_service_subscribe(SECOND_UNIT, handle_time_tick);
-  } else {
-    tick_timer_service_unsubscribe();
-    tick_timer_service_subscribe(MINUTE_UNIT, handle_time_tick);
+  if (!protocol || protocol->value->int32 != PROTOCOL_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Ignoring message for protocol %d.",
+	    protocol ? (int) protocol->value->int32 : 0);
+    return;
+  }
+
+  // a profiling request carries nothing else; builds without RENDER_STATS
+  // just ignore it.
+  if (render_stats_request) {
+#ifdef RENDER_STATS
+    render_stats_send();
+#endif
+    return;
+  }
+
+  if (latitude && longitude) {
+    receive_position(latitude->value->int32, longitude->value->int32);
+  }
+
+  // the phone follows a location update with its sunrise/sunset table for
+  // that location, a chunk per message. It is for the phone's position
+  // even when a city is selected; the lookup then just doesn't match.
+  if (sun_table_start && sun_table_offset && sun_table_count && sun_table_data) {
+    sun_table_receive(sun_table_start->value->int32,
+		      sun_table_offset->value->int32,
+		      sun_table_count->value->int32,
+		      sun_table_data->value->data,
+		      sun_table_data->length,
+		      saved_position.latitude_e6 / 1000000.0f,
+		      saved_position.longitude_e6 / 1000000.0f);
+    ephemeris_invalidate();
+  }
+
+  if (manual_offset) {
+    setting_manual_offset = manual_offset->value->int32;
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "MO: %d", setting_manual_offset);
+  }
+
+  if (flags) {
+    uint32_t bits = flags->value->uint32;
+    setting_second_hand = bits & FLAG_SECOND_HAND;
+    setting_digital_display = bits & FLAG_DIGITAL_DISPLAY;
+    bool hour_numbers = bits & FLAG_HOUR_NUMBERS;
+    if (hour_numbers != setting_hour_numbers) {
+      sprite_invalidate(&dial_sprite);
+    }
+    setting_hour_numbers = hour_numbers;
+    setting_moon_phase = bits & FLAG_MOON_PHASE;
+    setting_battery_status = bits & FLAG_BATTERY_STATUS;
+    setting_daylight_savings = bits & FLAG_DAYLIGHT_SAVINGS;
+    setting_manual_timezone = bits & FLAG_MANUAL_TIMEZONE;
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "FLAGS: 0x%02x", (unsigned) bits);
+  }
+
+  if (glance_seconds) {
+    setting_glance_seconds = glance_seconds->value->int32;
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "GS: %d", setting_glance_seconds);
+  }
+
+  if (city_id && city_id->value->int32 != setting_city) {
+    select_city(city_id->value->int32);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "CITY: %d", setting_city);
   }
+
+  if (utc_offset) {
+    tz_schedule_receive(utc_offset->value->int32,
+			tz_transitions ? tz_transitions->value->data : NULL,
+			tz_transitions ? tz_transitions->length : 0);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "UTC offset: %d min, %d transitions.", (int) utc_offset->value->int32,
+	    tz_transitions ? tz_transitions->length / TZ_SCHEDULE_RECORD_SIZE : 0);
+  }
+
+  update_timezone();
+
+  // the ephemeris is keyed on the location and UTC offset, so this only
+  // recomputes when one of them changed; sunrise and sunset may have moved.
+  update_daily_state();
+  schedule_day_event();
+
+  // if the second hand is enabled, we need to make sure the face updates on the appropriate tick event.
+  update_glance_mode();
+
+  // any of the display settings may have changed.
+  layer_mark_dirty(window_get_root_layer(window));
 }
 
 void in_dropped_handler(AppMessageResult reason, void *context) {
@@ -218,75 +411,14 @@ void out_failed_handler(DictionaryIterator *failed, AppMessageResult reason, voi
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Message FAILED to send to phone.");
 }
 
-void adjustTimezone(float* time) 
-{
-  int corrected_time = 12 + tz;
-  if (setting_daylight_savings) {
-    corrected_time += 1;
-  }
-  *time += corrected_time;
-    if (*time > 24) *time -= 24;
-    if (*time < 0) *time += 24;
-}
-
-// results are pretty awful for `outline_pixel' values larger than 2...
-static void draw_outlined_text(GContext* ctx, char* text, GFont font, GRect rect, GTextOverflowMode mode, GTextAlignment alignment, int outline_pixels, bool inverted) {
-  (inverted) ? graphics_context_set_text_color(ctx, GColorBlack) :
-    graphics_context_set_text_color(ctx, GColorWhite);
-
-  GRect volatile_rect = rect;
-  for (int i=0; i<outline_pixels; i++) {
-    volatile_rect.origin.x+=1;
-    graphics_draw_text(ctx,
-		       text,
-		       font,
-		       volatile_rect,
-		       mode,
-		       alignment,
-		       NULL);
-  }
-  volatile_rect = rect;
-  for (int i=0; i<outline_pixels; i++) {
-    volatile_rect.origin.y+=1;
-    graphics_draw_text(ctx,
-		       text,
-		       font,
-		       volatile_rect,
-		       mode,
-		       alignment,
-		       NULL);
-  }
-  volatile_rect = rect;
-  for (int i=0; i<outline_pixels; i++) {
-    volatile_rect.origin.x-=1;
-    graphics_draw_text(ctx,
-		       text,
-		       font,
-		       volatile_rect,
-		       mode,
-		       alignment,
-		       NULL);
-  }
-  volatile_rect = rect;
-  for (int i=0; i<outline_pixels; i++) {
-    volatile_rect.origin.y-=1;
-    graphics_draw_text(ctx,
-		       text,
-		       font,
-		       volatile_rect,
-		       mode,
-		       alignment,
-		       NULL);
-  }
-  (inverted) ? graphics_context_set_text_color(ctx, GColorWhite) :
-    graphics_context_set_text_color(ctx, GColorBlack);
-  graphics_draw_text(ctx,
-		     text,
-		     font,
-		     rect,
-		     mode,
-		     alignment,
-		     NULL);
+// hours east of UTC. The phone's schedule already includes DST; the
+// toggle only applies to a manual timezone, a city or the guess.
+static float current_utc_offset(void) {
+  int minutes;
+  if (!setting_manual_timezone && tz_schedule_offset(time(NULL), &minutes)) {
+    return minutes / 60.0f;
+  }
+  return tz + (setting_daylight_savings ? 1 : 0);
 }
 
 static void draw_dot(GContext* ctx, GPoint center, int radius) {
@@ -299,17 +431,21 @@ static void draw_dot(GContext* ctx, GPoint center, int radius) {
 }
 
 static void update_battery_percentage(BatteryChargeState c) {
-  if (setting_battery_status) {
+  if (setting_battery_status && c.charge_percent != current_battery_charge) {
     int battery_level_int = c.charge_percent;
+    current_battery_charge = battery_level_int;
     snprintf(battery_level_string, sizeof(battery_level_string), "%d%%", battery_level_int);
+    label_set_text(&battery_label, battery_level_string);
     layer_mark_dirty(battery_layer);
     APP_LOG(APP_LOG_LEVEL_DEBUG, "Battery change: battery_layer marked dirty...");
   }
 }
 
-static void face_layer_update_proc(Layer *layer, GContext *ctx) {
+// draws the static dial: bezel rings, hour marks and (optionally) hour numbers.
+static void draw_dial(GContext *ctx, void *data) {
+  Layer *layer = data;
   GRect bounds = layer_get_bounds(layer);
-  GPoint center = grect_center_point(&bounds);
+  GPoint center = DIAL_CENTER;
 
 
   /*******************************
@@ -317,61 +453,23 @@ static void face_layer_update_proc(Layer *layer, GContext *ctx) {
   *********************************/
   graphics_context_set_stroke_color(ctx, GColorBlack);
   graphics_draw_circle(ctx, center, 65);
-  graphics_context_set_stroke_color(ctx, GColorWhite);
-  graphics_draw_circle(ctx, center, 66);
-  // yes, I'm really doing this...
-  for (int i=67;i<72;i++) {
-      graphics_draw_circle(ctx, center, i);
-  }
-  center.y+=1;
-  for (int i=67;i<72;i++) {
-      graphics_draw_circle(ctx, center, i);
-  }
-  center.y-=1;
-  graphics_context_set_stroke_color(ctx, GColorBlack);
-  for (int i=72;i<120;i++) {
-      graphics_draw_circle(ctx, center, i);
-  }
-  center.y+=1;
-  for (int i=72;i<120;i++) {
-      graphics_draw_circle(ctx, center, i);
-  }
-
-  float rad_factor = M_PI / 180;
-  float deg_step;
+  // white bezel, then black out everything beyond it to the screen edges.
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  fill_annulus(ctx, bounds, center, 66, 71);
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  fill_annulus(ctx, bounds, center, 72, 120);
 
   // draw semi major hour marks
-  deg_step = 45;
-  for (int i=0;i<8;i++) {
-    float current_rads = rad_factor * (deg_step * i);
-    float x = 72 + 60 * (my_cos(current_rads));
-    float y = 84 + 60 * (my_sin(current_rads));
-    GPoint current_point;
-    current_point.x = (int16_t)x;
-    current_point.y = (int16_t)y;
-    draw_dot(ctx, current_point, 3);
+  for (int i=0;i<DIAL_STEPS;i+=3) {
+    draw_dot(ctx, dial_mark_points[i], 3);
   }
   // draw each hour mark
-  deg_step = 15;
-  for (int i=0;i<24;i++) {
-    float current_rads = rad_factor * (deg_step * i);
-    float x = 72 + 60 * (my_cos(current_rads));
-    float y = 84 + 60 * (my_sin(current_rads));
-    GPoint current_point;
-    current_point.x = (int16_t)x;
-    current_point.y = (int16_t)y;
-    draw_dot(ctx, current_point, 1);
+  for (int i=0;i<DIAL_STEPS;i++) {
+    draw_dot(ctx, dial_mark_points[i], 1);
   }
   // draw major hour marks
-  deg_step = 90;
-  for (int i=0;i<4;i++) {
-    float current_rads = rad_factor * (deg_step * i);
-    float x = 72 + 60 * (my_cos(current_rads));
-    float y = 84 + 60 * (my_sin(current_rads));
-    GPoint current_point;
-    current_point.x = (int16_t)x;
-    current_point.y = (int16_t)y;
-    draw_dot(ctx, current_point, 4);
+  for (int i=0;i<DIAL_STEPS;i+=6) {
+    draw_dot(ctx, dial_mark_points[i], 4);
   }
 
   /*************************
@@ -390,14 +488,8 @@ static void face_layer_update_proc(Layer *layer, GContext *ctx) {
     fake_time.tm_hour = 6;
     strftime(hour_text, sizeof(hour_text), time_format, &fake_time);
 
-    deg_step = 45;
-    for (int i=0;i<8;i++) {
-      float current_rads = rad_factor * (deg_step * i);
-      float x = 72 + 48 * (my_cos(current_rads));
-      float y = 84 + 48 * (my_sin(current_rads));
-      GPoint current_point;
-      current_point.x = (int16_t)x;
-      current_point.y = (int16_t)y;
+    for (int i=0;i<DIAL_STEPS;i+=3) {
+      GPoint current_point = dial_numeral_points[i];
 
       draw_outlined_text(ctx,
 			 hour_text,
@@ -414,6 +506,24 @@ static void face_layer_update_proc(Layer *layer, GContext *ctx) {
   }
 }
 
+// the dial never changes between settings updates, so it is rendered once
+// into `dial_sprite' and then just composited over the sunlight/moon layers.
+static void face_layer_update_proc(Layer *layer, GContext *ctx) {
+  if (!dial_sprite.and_mask) {
+    // not enough memory for the cache; draw it the slow way.
+    draw_dial(ctx, layer);
+    return;
+  }
+  if (!dial_sprite.valid) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Rendering dial sprite...");
+    if (!sprite_render(&dial_sprite, ctx, draw_dial, layer)) {
+      draw_dial(ctx, layer);
+      return;
+    }
+  }
+  sprite_draw(&dial_sprite, ctx);
+}
+
 static const GPathInfo p_hour_hand_info = {
   .num_points = 6,
   .points = (GPoint []) {{4,0},{0,8},{-4,0},{-3,-60},{0,-65},{3,-60}}
@@ -425,12 +535,6 @@ static const GPathInfo p_second_hand_info = {
 };
 
 static void hand_layer_update_proc(Layer* layer, GContext* ctx) {
-  GRect bounds = layer_get_bounds(layer);
-  GPoint center = grect_center_point(&bounds);
-
-  static GPath *p_hour_hand = NULL;
-  static GPath *p_second_hand = NULL;
-
   time_t now_epoch = time(NULL);
   struct tm *now = localtime(&now_epoch);
 
@@ -444,322 +548,252 @@ static void hand_layer_update_proc(Layer* layer, GContext* ctx) {
 
   // draw the hour hand
   graphics_context_set_stroke_color(ctx, GColorWhite);
-  p_hour_hand = gpath_create(&p_hour_hand_info);
   graphics_context_set_fill_color(ctx, GColorBlack);
-  gpath_move_to(p_hour_hand, center);
-  gpath_rotate_to(p_hour_hand, TRIG_MAX_ANGLE / 360 * hour_angle);
-  gpath_draw_filled(ctx, p_hour_hand);
-  gpath_draw_outline(ctx, p_hour_hand);
-  gpath_destroy(p_hour_hand);
+  gpath_rotate_to(hour_hand_path, TRIG_MAX_ANGLE / 360 * hour_angle);
+  gpath_draw_filled(ctx, hour_hand_path);
+  gpath_draw_outline(ctx, hour_hand_path);
 
   // draw the second hand
-  if (setting_second_hand) {
+  if (second_hand_visible()) {
     graphics_context_set_stroke_color(ctx, GColorBlack);
-    p_second_hand = gpath_create(&p_second_hand_info);
     graphics_context_set_fill_color(ctx, GColorWhite);
-    gpath_move_to(p_second_hand, center);
-    gpath_rotate_to(p_second_hand, TRIG_MAX_ANGLE / 360 * second_angle);
-    gpath_draw_filled(ctx, p_second_hand);
-    gpath_draw_outline(ctx, p_second_hand);
-    gpath_destroy(p_second_hand);
+    gpath_rotate_to(second_hand_path, TRIG_MAX_ANGLE / 360 * second_angle);
+    gpath_draw_filled(ctx, second_hand_path);
+    gpath_draw_outline(ctx, second_hand_path);
   }
 }
 
-GPathInfo sun_path_moon_mask_info = {
-  5,
-  (GPoint []) {
-    {0, 0},
-    {-73, +84}, //replaced by sunrise angle
-    {-73, -84}, //top left
-    {+73, -84}, //top right
-    {+73, +84}, //replaced by sunset angle
+// formats the sunrise/sunset labels from the ephemeris; "....." until the
+// phone has sent a position.
+static void update_sun_labels(void) {
+  char text[LABEL_MAX_TEXT];
+  if (!position) {
+    label_set_text(&sunrise_label, ".....");
+    label_set_text(&sunset_label, ".....");
+    return;
   }
-};
+  time_t now_epoch = time(NULL);
+  struct tm *event_time = localtime(&now_epoch);
+
+  // the ephemeris is in dial hours: local time + 12.
+  event_time->tm_min = (int)(60*(ephemeris.sunrise-((int)(ephemeris.sunrise))));
+  event_time->tm_hour = (int)ephemeris.sunrise - 12;
+  strftime(text, sizeof(text), current_time_format(), event_time);
+  label_set_text(&sunrise_label, text);
+  event_time->tm_min = (int)(60*(ephemeris.sunset-((int)(ephemeris.sunset))));
+  event_time->tm_hour = (int)ephemeris.sunset + 12;
+  strftime(text, sizeof(text), current_time_format(), event_time);
+  label_set_text(&sunset_label, text);
+}
 
-GPathInfo sun_path_info = {
-  5,
-  (GPoint []) {
-    {0, 0},
-    {-73, +84}, //replaced by sunrise angle
-    {-73, +84}, //bottom left
-    {+73, +84}, //bottom right
-    {+73, +84}, //replaced by sunset angle
+// brings the shared ephemeris (and with it the night spans) up to date;
+// the labels are only reformatted when it has actually been recomputed.
+static bool refresh_ephemeris(struct tm *now) {
+  if (!ephemeris_update(now, lat, lon, current_utc_offset())) {
+    return false;
   }
-};
-
-static void sunlight_layer_update_proc(Layer* layer, GContext* ctx) {
-  GRect bounds = layer_get_bounds(layer);
-  GPoint center = grect_center_point(&bounds);
+  update_sun_labels();
+  return true;
+}
 
+// recomputes everything that only changes by the day (or when the phone
+// sends a new position or settings) and marks the layers showing it, but
+// only if it actually changed.
+static void update_daily_state(void) {
   time_t now_epoch = time(NULL);
-  struct tm *time = localtime(&now_epoch);
-  /* struct tm *sunrise_time = localtime(&now_epoch); */
-  /* struct tm *sunset_time = localtime(&now_epoch); */
+  struct tm *now = localtime(&now_epoch);
 
-  float sunriseTime = calcSunRise(time->tm_year, time->tm_mon+1, time->tm_mday, lat, lon, 91.0f);
-  float sunsetTime = calcSunSet(time->tm_year, time->tm_mon+1, time->tm_mday, lat, lon, 91.0f);
+  if (refresh_ephemeris(now)) {
+    layer_mark_dirty(sunlight_layer);
+    layer_mark_dirty(moon_layer);
+    layer_mark_dirty(sunrise_sunset_text_layer);
+  }
+  if (update_date_labels(now)) {
+    layer_mark_dirty(date_text_layer);
+  }
+}
 
-  adjustTimezone(&sunriseTime);
-  adjustTimezone(&sunsetTime);
+static void day_event(void *data);
 
-  sun_path_info.points[1].x = (int16_t)(my_sin(sunriseTime/24 * M_PI * 2) * 120);
-  sun_path_info.points[1].y = -(int16_t)(my_cos(sunriseTime/24 * M_PI * 2) * 120);
+// arms a one-shot timer for the next local midnight or DST transition,
+// whichever comes first: the ephemeris and labels are per day, so
+// nothing else can change them. A timer that fires a little early just
+// finds nothing changed and re-arms for the remaining second.
+static void schedule_day_event(void) {
+  time_t now_epoch = time(NULL);
+  struct tm *now = localtime(&now_epoch);
+  int32_t seconds = now->tm_hour * 3600 + now->tm_min * 60 + now->tm_sec;
 
-  sun_path_info.points[4].x = (int16_t)(my_sin(sunsetTime/24 * M_PI * 2) * 120);
-  sun_path_info.points[4].y = -(int16_t)(my_cos(sunsetTime/24 * M_PI * 2) * 120);
+  int32_t next = 24 * 3600;
+  time_t transition = tz_schedule_next_transition(now_epoch);
+  if (transition && transition - now_epoch < next - seconds) {
+    next = seconds + (int32_t)(transition - now_epoch);
+  }
 
-  sun_path_moon_mask_info.points[1].x = (int16_t)(my_sin(sunriseTime/24 * M_PI * 2) * 120);
-  sun_path_moon_mask_info.points[1].y = -(int16_t)(my_cos(sunriseTime/24 * M_PI * 2) * 120);
+  uint32_t timeout_ms = (uint32_t)(next - seconds) * 1000;
+  if (!day_event_timer || !app_timer_reschedule(day_event_timer, timeout_ms)) {
+    day_event_timer = app_timer_register(timeout_ms, day_event, NULL);
+  }
+}
 
-  sun_path_moon_mask_info.points[4].x = (int16_t)(my_sin(sunsetTime/24 * M_PI * 2) * 120);
-  sun_path_moon_mask_info.points[4].y = -(int16_t)(my_cos(sunsetTime/24 * M_PI * 2) * 120);
+static void day_event(void *data) {
+  day_event_timer = NULL;
+  update_daily_state();
+  schedule_day_event();
+}
 
-  struct GPath *sun_path;
-  sun_path = gpath_create(&sun_path_info);
-  graphics_context_set_stroke_color(ctx, GColorBlack);
-  graphics_context_set_fill_color(ctx, GColorBlack);
-  gpath_move_to(sun_path, center);
-  if (position) {
-    gpath_draw_outline(ctx, sun_path);
-    gpath_draw_filled(ctx, sun_path);
+// spans as the ephemeris keeps them, in the coordinates of the layers
+// covering the dial interior.
+static SpanMask dial_mask(const Span (*rows)[RASTER_SPANS_PER_ROW]) {
+  return (SpanMask) {
+    .center = DIAL_INTERIOR_CENTER,
+    .radius = EPHEMERIS_NIGHT_RADIUS,
+    .rows = rows,
+  };
+}
+
+static SpanMask night_mask(void) {
+  return dial_mask(ephemeris.night);
+}
+
+static void sunlight_layer_update_proc(Layer* layer, GContext* ctx) {
+  if (!position) {
+    return;
+  }
+  if (ephemeris.polar[EPHEMERIS_SUN] == SUNCALC_ALWAYS_ABOVE) {
+    // midnight sun: not even civil twilight, so nothing to draw. (In a
+    // polar night every row is full, which is a memset per row.)
+    return;
   }
-  gpath_destroy(sun_path);
+  SpanMask twilight = dial_mask(ephemeris.twilight);
+  fill_span_mask_direct(ctx, DIAL_INTERIOR_FRAME.origin, layer_get_bounds(layer), &twilight, GColorBlack);
 }
 
 static void battery_layer_update_proc(Layer* layer, GContext* ctx) {
   if (setting_battery_status) {
-    draw_outlined_text(ctx,
-		       battery_level_string,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_14),
-		       GRect(55, 153, 40, 40),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentCenter,
-		       1,
-		       true);
+    label_draw(&battery_label, ctx);
   }
 }
 
-static void sunrise_sunset_text_layer_update_proc(Layer* layer, GContext* ctx) {
-  time_t now_epoch = time(NULL);
-  struct tm *now = localtime(&now_epoch);
-  struct tm *sunrise_time = localtime(&now_epoch);
-  struct tm *sunset_time = localtime(&now_epoch);
-  static char sunrise_text[] = "     ";
-  static char sunset_text[] = "     ";
-  static char time_text[] = "     ";
-  static char month_text[] = "   ";
-  static char day_text[] = "  ";
-  char *time_format;
-  if (clock_is_24h_style()) {
-    time_format = "%H:%M";
-  }
-  else {
-    time_format = "%l:%M";
-  }
-  char *month_format = "%b";
-  char *day_format = "%e";
-  char *ellipsis = ".....";
-
-  // don't calculate these if they've already been done for the day or if `lat' and `lon' haven't
-  // been received from the phone yet.
-  if ((current_sunrise_sunset_day != now->tm_mday)) {
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Re-calculating sunrise/sunset...");
-    sunriseTime = calcSunRise(now->tm_year, now->tm_mon+1, now->tm_mday, lat, lon, 91.0f);
-    sunsetTime = calcSunSet(now->tm_year, now->tm_mon+1, now->tm_mday, lat, lon, 91.0f);
-    adjustTimezone(&sunriseTime);
-    adjustTimezone(&sunsetTime);
-    // don't calculate them again until tomorrow (unless we still don't have position)
-    if (position) {
-      current_sunrise_sunset_day = now->tm_mday;
-    }
+static void time_text_layer_update_proc(Layer* layer, GContext* ctx) {
+  if (setting_digital_display) {
+    label_draw(&time_label, ctx);
   }
+}
 
-  // draw current time
-  if (setting_digital_display) {
-    strftime(time_text, sizeof(time_text), time_format, now);
-    draw_outlined_text(ctx,
-		       time_text,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD),
-		       GRect(42, 47, 64, 32),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentCenter,
-		       1,
-		       false);
-  }
-  // print sunrise/sunset times (if we can calculate our position)
-  sunrise_time->tm_min = (int)(60*(sunriseTime-((int)(sunriseTime))));
-  sunrise_time->tm_hour = (int)sunriseTime - 12;
-  strftime(sunrise_text, sizeof(sunrise_text), time_format, sunrise_time);
-  sunset_time->tm_min = (int)(60*(sunsetTime-((int)(sunsetTime))));
-  sunset_time->tm_hour = (int)sunsetTime + 12;
-  strftime(sunset_text, sizeof(sunset_text), time_format, sunset_time);
-  graphics_context_set_text_color(ctx, GColorWhite);
-
-  if (position) {
-    graphics_draw_text(ctx,
-		       sunrise_text,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		       GRect(3, 145, 144-3, 168-145),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentLeft,
-		       NULL);
-    graphics_draw_text(ctx,
-		       sunset_text,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		       GRect(3, 145, 144-3, 168-145),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentRight,
-		       NULL);
-  }
-  else {
-    graphics_draw_text(ctx,
-		       ellipsis,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		       GRect(3, 145, 144-3, 168-145),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentLeft,
-		       NULL);
-    graphics_draw_text(ctx,
-		       ellipsis,
-		       fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		       GRect(3, 145, 144-3, 168-145),
-		       GTextOverflowModeWordWrap,
-		       GTextAlignmentRight,
-		       NULL);
-  }
-
-  //draw current date month
-  strftime(month_text, sizeof(month_text), month_format, now);
-  draw_outlined_text(ctx,
-		     month_text,
-		     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		     GRect(3, 0, 144-3, 32),
-  		     GTextOverflowModeWordWrap,
-  		     GTextAlignmentLeft,
-		     0,
-		     true);
-  //draw current date day
-  strftime(day_text, sizeof(day_text), day_format, now);
-  draw_outlined_text(ctx,
-		     day_text,
-		     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
-		     GRect(3, 0, 144-13, 32),
-  		     GTextOverflowModeWordWrap,
-  		     GTextAlignmentRight,
-		     0,
-		     true);
-}
-
-int moon_phase(struct tm *time) {
-  int y,m;
-  double jd;
-  int jdn;
-  y = time->tm_year + 1900;
-  m = time->tm_mon + 1;
-  jdn = time->tm_mday-32075+1461*(y+4800+(m-14)/12)/4+367*(m-2-(m-14)/12*12)/12-3*((y+4900+(m-14)/12)/100)/4;
-  jd = jdn-2451550.1;
-  jd /= 29.530588853;
-  jd -= (int)jd;
-  return (int)(jd*27 + 0.5); /* scale fraction from 0-27 and round by adding 0.5 */
+static void date_text_layer_update_proc(Layer* layer, GContext* ctx) {
+  label_draw(&month_label, ctx);
+  label_draw(&day_label, ctx);
+}
+
+static void sunrise_sunset_text_layer_update_proc(Layer* layer, GContext* ctx) {
+  label_draw(&sunrise_label, ctx);
+  label_draw(&sunset_label, ctx);
 }
 
 static void moon_layer_update_proc(Layer* layer, GContext* ctx) {
   if (setting_moon_phase) {
-    time_t now_epoch = time(NULL);
-    struct tm *now = localtime(&now_epoch);
-
-    // don't do any calculations if they've already been done for today.
-    if (current_moon_day != now->tm_mday) {
-      phase = moon_phase(now);
-      // we don't have to calculate this again until tomorrow...
-      current_moon_day = now->tm_mday;
-    }
-
-    int moon_y = 108;  // y-axis position of the moon's center
-    int moon_r = 15;   // radius of the moon
+    // moon_layer covers the dial interior, so convert to its coordinates.
+    int moon_x = DIAL_INTERIOR_RADIUS;
+    int moon_y = DIAL_MOON_CENTER_Y - DIAL_CENTER_Y + DIAL_INTERIOR_RADIUS;  // y-axis position of the moon's center
+    int moon_r = DIAL_MOON_RADIUS;    // radius of the moon
 
-    // draw the moon...
+    // draw the moon, but only where it is night: every pixel is written
+    // once and nothing depends on the daylight being painted over it.
     if (position) {
-      if (phase != 27) {
-	graphics_context_set_fill_color(ctx,GColorWhite);
-	graphics_fill_circle(ctx, GPoint(72,moon_y), moon_r);
-      }
-      if (phase == 27 || phase == 0) {
-	graphics_context_set_stroke_color(ctx,GColorWhite);
-	graphics_draw_circle(ctx, GPoint(72,moon_y), moon_r);
-      }
-
-      if (phase != 15 && phase != 27 ) { 
-	if (phase < 15) {
-	  // draw the waxing occlusion...
-	  graphics_context_set_fill_color(ctx,GColorBlack);
-	  graphics_fill_circle(ctx, GPoint(72 - (phase * 6), moon_y), moon_r + (phase * 4));
-	}
-
-	if (phase > 15) {
-	  // draw the waning occlusion...
-	  int phase_factor = abs(phase-30);
-	  graphics_context_set_fill_color(ctx,GColorBlack);
-	  graphics_fill_circle(ctx, GPoint(((72-3) + (phase_factor * 6)), moon_y), moon_r + (phase_factor * 4));
-	}
-      }
+      SpanMask night = night_mask();
+      fill_moon(ctx, layer_get_bounds(layer), &night, GPoint(moon_x, moon_y), moon_r, ephemeris.moon_phase);
     }
-
-    // mask off the "daylight" portion of the watchface, otherwise, we
-    // see the occlusion circles where the "night" portion does not cover.
-    // This is probably the messiest bit of the watch app, since it assumes
-    // that a lot of things are happening in the right order to work...
-    GRect bounds = layer_get_bounds(layer);
-    GPoint center = grect_center_point(&bounds);
-    struct GPath *sun_path_moon_mask;
-    sun_path_moon_mask = gpath_create(&sun_path_moon_mask_info);
-    graphics_context_set_stroke_color(ctx, GColorBlack);
-    graphics_context_set_fill_color(ctx, GColorWhite);
-    gpath_move_to(sun_path_moon_mask, center);
-    if (position) {
-      gpath_draw_outline(ctx, sun_path_moon_mask);
-      gpath_draw_filled(ctx, sun_path_moon_mask);
-    }
-    gpath_destroy(sun_path_moon_mask);
   }
 }
 
 static void window_unload(Window *window) {
+  sprite_deinit(&dial_sprite);
+  gpath_destroy(hour_hand_path);
+  gpath_destroy(second_hand_path);
+  label_deinit(&time_label);
+  label_deinit(&month_label);
+  label_deinit(&day_label);
+  label_deinit(&sunrise_label);
+  label_deinit(&sunset_label);
+  label_deinit(&battery_label);
 }
 
 static void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_bounds(window_layer);
 
+  // both hands pivot on the dial centre.
+  hour_hand_path = gpath_create(&p_hour_hand_info);
+  second_hand_path = gpath_create(&p_second_hand_info);
+  gpath_move_to(hour_hand_path, DIAL_INTERIOR_CENTER);
+  gpath_move_to(second_hand_path, DIAL_INTERIOR_CENTER);
+
+  // each layer only covers the part of the screen it paints, so its
+  // update proc is clipped to that region.
+
   // sunlight_layer
-  sunlight_layer = layer_create(bounds);
-  layer_set_update_proc(sunlight_layer, &sunlight_layer_update_proc);
+  sunlight_layer = layer_create(DIAL_INTERIOR_FRAME);
+  RENDER_STATS_SET_UPDATE_PROC(sunlight_layer, sunlight_layer_update_proc);
   layer_add_child(window_layer, sunlight_layer);
 
   // moon_layer
-  moon_layer = layer_create(bounds);
-  layer_set_update_proc(moon_layer, &moon_layer_update_proc);
+  moon_layer = layer_create(DIAL_INTERIOR_FRAME);
+  RENDER_STATS_SET_UPDATE_PROC(moon_layer, moon_layer_update_proc);
   layer_add_child(window_layer, moon_layer);
 
-  // clockface_layer
+  // clockface_layer (the bezel reaches the screen corners)
   face_layer = layer_create(bounds);
-  layer_set_update_proc(face_layer, &face_layer_update_proc);
+  RENDER_STATS_SET_UPDATE_PROC(face_layer, face_layer_update_proc);
   layer_add_child(window_layer, face_layer);
+  sprite_init(&dial_sprite, bounds, GPointZero);
 
   // hand_layer
-  hand_layer = layer_create(bounds);
-  layer_set_update_proc(hand_layer, &hand_layer_update_proc);
+  hand_layer = layer_create(DIAL_INTERIOR_FRAME);
+  RENDER_STATS_SET_UPDATE_PROC(hand_layer, hand_layer_update_proc);
   layer_add_child(window_layer, hand_layer);
 
-  // sunrise_sunset_text_layer
-  sunrise_sunset_text_layer = layer_create(bounds);
-  layer_set_update_proc(sunrise_sunset_text_layer, &sunrise_sunset_text_layer_update_proc);
+  // time_text_layer
+  GRect time_frame = GRect(42, 47, 64, 32);
+  time_text_layer = layer_create(time_frame);
+  RENDER_STATS_SET_UPDATE_PROC(time_text_layer, time_text_layer_update_proc);
+  layer_add_child(window_layer, time_text_layer);
+  label_init(&time_label, GRect(0, 0, 64, 32), time_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD), GTextAlignmentCenter, 1, false);
+
+  // date_text_layer: month on the left, day on the right
+  GRect date_frame = GRect(3, 0, 144-3, 32);
+  date_text_layer = layer_create(date_frame);
+  RENDER_STATS_SET_UPDATE_PROC(date_text_layer, date_text_layer_update_proc);
+  layer_add_child(window_layer, date_text_layer);
+  label_init(&month_label, GRect(0, 0, 48, 24), date_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), GTextAlignmentLeft, 0, true);
+  label_init(&day_label, GRect(date_frame.size.w - 10 - 32, 0, 32, 24), date_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), GTextAlignmentRight, 0, true);
+
+  // sunrise_sunset_text_layer: sunrise on the left, sunset on the right
+  GRect sunrise_sunset_frame = GRect(3, 145, 144-3, 168-145);
+  sunrise_sunset_text_layer = layer_create(sunrise_sunset_frame);
+  RENDER_STATS_SET_UPDATE_PROC(sunrise_sunset_text_layer, sunrise_sunset_text_layer_update_proc);
   layer_add_child(window_layer, sunrise_sunset_text_layer);
-  
+  label_init(&sunrise_label, GRect(0, 0, 56, 23), sunrise_sunset_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), GTextAlignmentLeft, 0, true);
+  label_init(&sunset_label, GRect(sunrise_sunset_frame.size.w - 56, 0, 56, 23), sunrise_sunset_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD), GTextAlignmentRight, 0, true);
+  update_sun_labels();
+
   // battery_layer
-  battery_layer = layer_create(bounds);
-  layer_set_update_proc(battery_layer, &battery_layer_update_proc);
+  GRect battery_frame = GRect(55, 153, 40, 40);
+  battery_layer = layer_create(battery_frame);
+  RENDER_STATS_SET_UPDATE_PROC(battery_layer, battery_layer_update_proc);
   layer_add_child(window_layer, battery_layer);
+  label_init(&battery_label, GRect(0, 0, 40, 20), battery_frame.origin,
+	     fonts_get_system_font(FONT_KEY_GOTHIC_14), GTextAlignmentCenter, 1, true);
+  label_set_text(&battery_label, battery_level_string);
+
+  time_t now_epoch = time(NULL);
+  update_time_label(localtime(&now_epoch));
+  update_date_labels(localtime(&now_epoch));
 
 }
 
@@ -771,24 +805,7 @@ static void init(void) {
 
   battery_state_service_subscribe(update_battery_percentage);
 
-  app_message_open(app_message_inbox_size_maximum(),app_message_outbox_size_maximum());
-
-  window = window_create();
-  window_set_window_handlers(window, (WindowHandlers) {
-      .load = window_load,
-      .unload = window_unload,
-  });
-  const bool animated = true;
-  window_stack_push(window, animated);
-
-  /* if (persist_exists(ML) && */
-  /*     persist_exists(MLAT) && */
-  /*     persist_exists(MLON)) { */
-  /*   setting_manual_location = persist_read_bool(ML); */
-  /*   // FIXME */
-  /*   //    setting_manual_latitude = atof(persist_read_string(MLAT)); */
-  /*   //    setting_manual_timezone = atof(persist_read_string(MLON)); */
-  /* } */
+  app_message_open(INBOX_SIZE, OUTBOX_SIZE);
 
   if (persist_exists(MT) && persist_exists(MO)) {
       setting_manual_timezone = persist_read_bool(MT);
@@ -810,14 +827,41 @@ static void init(void) {
 
     APP_LOG(APP_LOG_LEVEL_DEBUG, (setting_manual_timezone) ? "true" : "false");
     APP_LOG(APP_LOG_LEVEL_DEBUG, "MO: %d", setting_manual_offset);
+  }
 
-    if (setting_second_hand) {
-      tick_timer_service_subscribe(SECOND_UNIT, handle_time_tick);
-    }
-    else {
-      tick_timer_service_subscribe(MINUTE_UNIT, handle_time_tick);
-    }
+  if (persist_exists(GS)) {
+    setting_glance_seconds = persist_read_int(GS);
   }
+
+  if (persist_exists(CITY)) {
+    setting_city = persist_read_int(CITY);
+  }
+
+  // bring back the last position and its ephemeris before the window is
+  // loaded, so the first frame is complete even if the phone never answers.
+  // The ephemeris is only recomputed if it is for another day or place.
+  // A manual city needs neither the phone nor a saved position.
+  restore_position();
+  select_city(setting_city);
+  tz_schedule_restore();
+  update_timezone();
+  ephemeris_restore();
+  time_t now_epoch = time(NULL);
+  ephemeris_update(localtime(&now_epoch), lat, lon, current_utc_offset());
+
+  window = window_create();
+  window_set_window_handlers(window, (WindowHandlers) {
+      .load = window_load,
+      .unload = window_unload,
+  });
+  const bool animated = true;
+  window_stack_push(window, animated);
+
+  // subscribe even without saved settings, so a fresh install ticks
+  // before the phone has sent anything.
+  update_glance_mode();
+  // from here on the day event timer keeps the ephemeris current.
+  schedule_day_event();
   // get the _actual_ battery state (global variables set it up as if it were 100%).
   update_battery_percentage(battery_state_service_peek());
 }
@@ -831,14 +875,19 @@ static void deinit(void) {
   persist_write_bool(DS, setting_daylight_savings);
   persist_write_bool(MT, setting_manual_timezone);
   persist_write_int(MO, setting_manual_offset);
-  /* persist_write_bool(ML, setting_manual_location); */
-  /* persist_write_string(MLAT, snprintf(setting_manual_latitude)); */
-  /* persist_write_string(MLON, setting_manual_longitude); */
+  persist_write_int(GS, setting_glance_seconds);
+  persist_write_int(CITY, setting_city);
+
+  if (day_event_timer) {
+    app_timer_cancel(day_event_timer);
+  }
 
   layer_remove_from_parent(moon_layer);
   layer_remove_from_parent(hand_layer);
   layer_remove_from_parent(sunlight_layer);
   layer_remove_from_parent(sunrise_sunset_text_layer);
+  layer_remove_from_parent(time_text_layer);
+  layer_remove_from_parent(date_text_layer);
   layer_remove_from_parent(face_layer);
   layer_remove_from_parent(battery_layer);
 
@@ -846,6 +895,8 @@ static void deinit(void) {
   layer_destroy(hand_layer);
   layer_destroy(sunlight_layer);
   layer_destroy(sunrise_sunset_text_layer);
+  layer_destroy(time_text_layer);
+  layer_destroy(date_text_layer);
   layer_destroy(moon_layer);
   layer_destroy(battery_layer);
 
@@ -856,8 +907,8 @@ int main(void) {
   init();
 
   APP_LOG(APP_LOG_LEVEL_DEBUG, "Done initializing, pushed window: %p", window);
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Max inbox size: %d.", (int) app_message_inbox_size_maximum());
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Max outbox size: %d.", (int) app_message_outbox_size_maximum());
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Inbox size: %d (max %d).", (int) INBOX_SIZE, (int) app_message_inbox_size_maximum());
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Outbox size: %d (max %d).", (int) OUTBOX_SIZE, (int) app_message_outbox_size_maximum());
 
   app_event_loop();
   deinit();
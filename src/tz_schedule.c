@@ -0,0 +1,50 @@
+#include "tz_schedule.h"
+
+typedef struct {
+  int16_t utc_offset;      // minutes, before the first transition
+  uint8_t count;
+  uint32_t time[TZ_SCHEDULE_MAX_TRANSITIONS];
+  int16_t offset[TZ_SCHEDULE_MAX_TRANSITIONS];
+} TzSchedule;
+
+static TzSchedule schedule;
+static bool valid = false;
+
+void tz_schedule_receive(int32_t utc_offset, const uint8_t *data, uint16_t length) {
+  schedule.utc_offset = utc_offset;
+  schedule.count = 0;
+  for (uint16_t i = 0; data && i + TZ_SCHEDULE_RECORD_SIZE <= length &&
+	 schedule.count < TZ_SCHEDULE_MAX_TRANSITIONS; i += TZ_SCHEDULE_RECORD_SIZE) {
+    const uint8_t *p = &data[i];
+    schedule.time[schedule.count] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    schedule.offset[schedule.count] = (int16_t)(p[4] | (p[5] << 8));
+    schedule.count++;
+  }
+  valid = true;
+  persist_write_data(TZ_SCHEDULE_PERSIST_KEY, &schedule, sizeof(schedule));
+}
+
+bool tz_schedule_restore(void) {
+  valid = persist_read_data(TZ_SCHEDULE_PERSIST_KEY, &schedule, sizeof(schedule)) == sizeof(schedule);
+  return valid;
+}
+
+bool tz_schedule_offset(time_t now, int *minutes) {
+  if (!valid) {
+    return false;
+  }
+  *minutes = schedule.utc_offset;
+  for (int i = 0; i < schedule.count && (uint32_t)now >= schedule.time[i]; i++) {
+    *minutes = schedule.offset[i];
+  }
+  return true;
+}
+
+time_t tz_schedule_next_transition(time_t now) {
+  for (int i = 0; valid && i < schedule.count; i++) {
+    if (schedule.time[i] > (uint32_t)now) {
+      return schedule.time[i];
+    }
+  }
+  return 0;
+}
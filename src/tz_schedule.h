@@ -0,0 +1,24 @@
+#pragma once
+#include <pebble.h>
+
+/*
+ * The phone's UTC offset and its next few DST transitions, so the watch
+ * knows its offset without guessing from the longitude and switches at
+ * the right instant without the phone.
+ *
+ * The phone sends its current offset in minutes east of UTC and a byte
+ * array of up to TZ_SCHEDULE_MAX_TRANSITIONS records: uint32 instant
+ * (seconds since the epoch, UTC) and int16 offset from that instant on,
+ * both little-endian, in ascending order.
+ */
+#define TZ_SCHEDULE_MAX_TRANSITIONS 4
+#define TZ_SCHEDULE_RECORD_SIZE 6
+#define TZ_SCHEDULE_PERSIST_KEY 0x31
+
+// `data' may be NULL when the phone knows of no transition.
+void tz_schedule_receive(int32_t utc_offset, const uint8_t *data, uint16_t length);
+bool tz_schedule_restore(void);
+// the offset in minutes at `now'; false if the phone never sent one.
+bool tz_schedule_offset(time_t now, int *minutes);
+// the first transition after `now', or 0 if none is known.
+time_t tz_schedule_next_transition(time_t now);
@@ -0,0 +1,249 @@
+/*
+ * Host benchmark for the watchface: runs the real app against the Pebble
+ * stub, feeds it a location/settings message like the phone would, then
+ * ticks a simulated clock and times every frame, layer by layer.
+ *
+ *   ./sunset-bench [--frames N] [--second-hand] [--lat L] [--lon L]
+ *                  [--start EPOCH] [--glance SECONDS] [--tap-every SECONDS]
+ *                  [--city ID] [--utc-offset MINUTES] [--transition EPOCH:MINUTES]
+ *                  [--pbm FILE] [--persist FILE] [--offline] [--no-alloc] [-v]
+ *
+ * --no-alloc makes it exit 1 if any frame after the first allocates.
+ * --persist keeps the watch's persistent storage in FILE between runs, and
+ * --offline never sends anything from the phone, to check a cold start.
+ * --city picks a city from resources/data/cities.bin as a manual location.
+ * --utc-offset sends the phone's offset, and each --transition (up to 4) a
+ * DST change to MINUTES at EPOCH.
+ */
+#include <math.h>
+#include "stub.h"
+
+int app_main(void);
+
+// the phone's side of the protocol in src/sunset-watch.c.
+#define PROTOCOL_VERSION 1
+
+enum {
+  MO = 0xA,
+  GS = 0x12,
+  PROTOCOL = 0x13,
+  LAT_E6 = 0x14,
+  LON_E6 = 0x15,
+  FLAGS = 0x16,
+  CITY = 0x18,
+  UTC_OFFSET = 0x19,
+  TZ_TRANSITIONS = 0x1A,
+  RENDER_STATS_REQUEST = 0x20,
+};
+
+enum {
+  FLAG_SECOND_HAND = 1 << 0,
+  FLAG_DIGITAL_DISPLAY = 1 << 1,
+  FLAG_HOUR_NUMBERS = 1 << 2,
+  FLAG_MOON_PHASE = 1 << 3,
+  FLAG_BATTERY_STATUS = 1 << 4,
+};
+
+static int frames = 1440;
+static bool second_hand = false;
+static double latitude = 40.7128;
+static double longitude = -74.0060;
+static time_t start = 1750507200;  // 2025-06-21 12:00 UTC
+static const char *pbm_path = NULL;
+static const char *persist_path = NULL;
+static bool offline = false;
+static int glance_seconds = 0;
+static int city = 0;
+static bool send_utc_offset = false;
+static int utc_offset = 0;
+static uint8_t transitions[4 * 6];
+static int transition_bytes = 0;
+static int tap_every = 0;
+static bool no_alloc = false;
+static bool failed = false;
+
+typedef struct {
+  GRect frame;
+  uint32_t frames;
+  uint64_t nanoseconds;
+  uint64_t max_nanoseconds;
+  uint64_t draw_calls;
+  uint64_t pixels;
+} LayerTotals;
+
+static void print_frame(const char *title, const StubFrameStats *stats) {
+  printf("%s: %.1f us, %u allocations\n", title, stats->nanoseconds / 1000.0, (unsigned)stats->allocations);
+  printf("  layer  frame               us      draws   pixels\n");
+  for (int i = 0; i < stats->layer_count; i++) {
+    const StubLayerStats *l = &stats->layers[i];
+    printf("  %-5d  %3d,%3d %3dx%-3d  %9.1f  %6u  %7u\n", i,
+           l->frame.origin.x, l->frame.origin.y, l->frame.size.w, l->frame.size.h,
+           l->nanoseconds / 1000.0, (unsigned)l->draw_calls, (unsigned)l->pixels);
+  }
+}
+
+static TimeUnits units_changed(const struct tm *a, const struct tm *b) {
+  TimeUnits units = 0;
+  if (a->tm_sec != b->tm_sec) units |= SECOND_UNIT;
+  if (a->tm_min != b->tm_min) units |= MINUTE_UNIT;
+  if (a->tm_hour != b->tm_hour) units |= HOUR_UNIT;
+  if (a->tm_mday != b->tm_mday) units |= DAY_UNIT;
+  if (a->tm_mon != b->tm_mon) units |= MONTH_UNIT;
+  if (a->tm_year != b->tm_year) units |= YEAR_UNIT;
+  return units;
+}
+
+// the same two messages the phone sends: its position, then the settings.
+static void send_settings(void) {
+  stub_inbox_begin();
+  stub_inbox_add_int32(PROTOCOL, PROTOCOL_VERSION);
+  stub_inbox_add_int32(LAT_E6, (int32_t)lround(latitude * 1000000));
+  stub_inbox_add_int32(LON_E6, (int32_t)lround(longitude * 1000000));
+  stub_inbox_deliver();
+
+  stub_inbox_begin();
+  stub_inbox_add_int32(PROTOCOL, PROTOCOL_VERSION);
+  stub_inbox_add_int32(FLAGS, (second_hand ? FLAG_SECOND_HAND : 0) | FLAG_DIGITAL_DISPLAY |
+                       FLAG_HOUR_NUMBERS | FLAG_MOON_PHASE | FLAG_BATTERY_STATUS);
+  stub_inbox_add_int32(MO, 0);
+  stub_inbox_add_int32(GS, glance_seconds);
+  stub_inbox_add_int32(CITY, city);
+  if (send_utc_offset) {
+    stub_inbox_add_int32(UTC_OFFSET, utc_offset);
+    stub_inbox_add_data(TZ_TRANSITIONS, transitions, transition_bytes);
+  }
+  stub_inbox_deliver();
+}
+
+void app_event_loop(void) {
+  StubFrameStats stats;
+  LayerTotals totals[STUB_MAX_LAYERS];
+  memset(totals, 0, sizeof(totals));
+  uint64_t frame_nanoseconds = 0, frame_max = 0, allocations = 0;
+  int rendered = 0;
+
+  if (!offline) send_settings();
+  if (stub_render(&stats)) print_frame("first frame", &stats);
+
+  for (int i = 0; i < frames; i++) {
+    time_t before = stub_get_time();
+    time_t step = (stub_tick_units() & SECOND_UNIT) ? 1 : 60;
+    time_t now = before - before % step + step;
+    struct tm prev = *localtime(&before);
+    struct tm tick_time = *localtime(&now);
+    stub_advance_to(now);
+    if (tap_every && (now - start) % tap_every < step) stub_tap();
+    stub_tick(&tick_time, units_changed(&prev, &tick_time));
+
+    if (!stub_render(&stats)) continue;
+    rendered++;
+    frame_nanoseconds += stats.nanoseconds;
+    if (stats.nanoseconds > frame_max) frame_max = stats.nanoseconds;
+    allocations += stats.allocations;
+    for (int l = 0; l < stats.layer_count; l++) {
+      LayerTotals *t = &totals[l];
+      t->frame = stats.layers[l].frame;
+      t->frames++;
+      t->nanoseconds += stats.layers[l].nanoseconds;
+      if (stats.layers[l].nanoseconds > t->max_nanoseconds) t->max_nanoseconds = stats.layers[l].nanoseconds;
+      t->draw_calls += stats.layers[l].draw_calls;
+      t->pixels += stats.layers[l].pixels;
+    }
+  }
+
+  if (rendered == 0) {
+    printf("no frames rendered\n");
+    return;
+  }
+  printf("\n%d ticks over %ld s, %d frames: avg %.1f us, max %.1f us, %.2f allocations/frame\n",
+         frames, (long)(stub_get_time() - start), rendered, frame_nanoseconds / 1000.0 / rendered, frame_max / 1000.0,
+         (double)allocations / rendered);
+  if (no_alloc && allocations) {
+    printf("FAIL: %lu allocations after the first frame\n", (unsigned long)allocations);
+    failed = true;
+  }
+  printf("  layer  frame               avg us     max us  draws   pixels\n");
+  for (int l = 0; l < STUB_MAX_LAYERS && totals[l].frames; l++) {
+    LayerTotals *t = &totals[l];
+    printf("  %-5d  %3d,%3d %3dx%-3d  %9.1f  %9.1f  %5.1f  %7.0f\n", l,
+           t->frame.origin.x, t->frame.origin.y, t->frame.size.w, t->frame.size.h,
+           t->nanoseconds / 1000.0 / t->frames, t->max_nanoseconds / 1000.0,
+           (double)t->draw_calls / t->frames, (double)t->pixels / t->frames);
+  }
+
+  // builds with -DRENDER_STATS answer this with their own summary.
+  stub_inbox_begin();
+  stub_inbox_add_int32(PROTOCOL, PROTOCOL_VERSION);
+  stub_inbox_add_int32(RENDER_STATS_REQUEST, 1);
+  stub_inbox_deliver();
+
+  if (pbm_path && !stub_write_pbm(pbm_path)) {
+    fprintf(stderr, "can't write %s\n", pbm_path);
+  }
+}
+
+// "EPOCH:MINUTES" -> one record of src/tz_schedule.h
+static bool add_transition(const char *arg) {
+  long when;
+  int minutes;
+  if (transition_bytes == sizeof(transitions) || sscanf(arg, "%ld:%d", &when, &minutes) != 2) {
+    return false;
+  }
+  uint8_t *p = &transitions[transition_bytes];
+  p[0] = when; p[1] = when >> 8; p[2] = when >> 16; p[3] = when >> 24;
+  p[4] = minutes; p[5] = minutes >> 8;
+  transition_bytes += 6;
+  return true;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [--frames N] [--second-hand] [--lat L] [--lon L] [--start EPOCH]\n"
+                  "       [--glance SECONDS] [--tap-every SECONDS] [--city ID] [--utc-offset MINUTES]\n"
+                  "       [--transition EPOCH:MINUTES] [--pbm FILE] [--persist FILE] [--offline]\n"
+                  "       [--no-alloc] [-v]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (strcmp(arg, "--frames") == 0 && has_value) frames = atoi(argv[++i]);
+    else if (strcmp(arg, "--second-hand") == 0) second_hand = true;
+    else if (strcmp(arg, "--lat") == 0 && has_value) latitude = atof(argv[++i]);
+    else if (strcmp(arg, "--lon") == 0 && has_value) longitude = atof(argv[++i]);
+    else if (strcmp(arg, "--start") == 0 && has_value) start = atol(argv[++i]);
+    else if (strcmp(arg, "--pbm") == 0 && has_value) pbm_path = argv[++i];
+    else if (strcmp(arg, "--glance") == 0 && has_value) glance_seconds = atoi(argv[++i]);
+    else if (strcmp(arg, "--tap-every") == 0 && has_value) tap_every = atoi(argv[++i]);
+    else if (strcmp(arg, "--city") == 0 && has_value) city = atoi(argv[++i]);
+    else if (strcmp(arg, "--utc-offset") == 0 && has_value) {
+      send_utc_offset = true;
+      utc_offset = atoi(argv[++i]);
+    }
+    else if (strcmp(arg, "--transition") == 0 && has_value) {
+      if (!add_transition(argv[++i])) usage(argv[0]);
+    }
+    else if (strcmp(arg, "--persist") == 0 && has_value) persist_path = argv[++i];
+    else if (strcmp(arg, "--offline") == 0) offline = true;
+    else if (strcmp(arg, "--no-alloc") == 0) no_alloc = true;
+    else if (strcmp(arg, "-v") == 0) stub_verbose = true;
+    else usage(argv[0]);
+  }
+
+  // the watch keeps local time; the app works out its own offset.
+  setenv("TZ", "UTC", 1);
+  tzset();
+  stub_set_time(start);
+  if (persist_path) stub_persist_load(persist_path);
+
+  app_main();
+
+  if (persist_path && !stub_persist_save(persist_path)) {
+    fprintf(stderr, "can't write %s\n", persist_path);
+  }
+  printf("\nSDK calls: graphics %u, gpath %u, layer %u, persist %u, resource %u\n",
+         (unsigned)stub_calls.graphics, (unsigned)stub_calls.gpath,
+         (unsigned)stub_calls.layer, (unsigned)stub_calls.persist, (unsigned)stub_calls.resource);
+  return failed ? 1 : 0;
+}
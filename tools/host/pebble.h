@@ -0,0 +1,240 @@
+/*
+ * Host stand-in for the parts of the Pebble SDK (3.x, aplite) that the
+ * watchface uses. Only declarations live here; pebble_stub.c implements
+ * them on top of an in-memory 144x168 1-bit frame buffer and records
+ * every call for bench.c.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* time() is driven by the harness' simulated clock */
+time_t stub_time(time_t *t);
+#define time(t) stub_time(t)
+
+/* logging */
+#define APP_LOG_LEVEL_ERROR 1
+#define APP_LOG_LEVEL_WARNING 50
+#define APP_LOG_LEVEL_INFO 100
+#define APP_LOG_LEVEL_DEBUG 200
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...);
+#define APP_LOG(level, fmt, args...) app_log(level, __FILE__, __LINE__, fmt, ## args)
+
+/* geometry */
+typedef struct GPoint { int16_t x; int16_t y; } GPoint;
+typedef struct GSize { int16_t w; int16_t h; } GSize;
+typedef struct GRect { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+#define GPointZero GPoint(0, 0)
+#define GSize(w, h) ((GSize){(w), (h)})
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+GPoint grect_center_point(const GRect *rect);
+bool grect_contains_point(const GRect *rect, const GPoint *point);
+
+/* colors (aplite only distinguishes black, white and clear) */
+typedef union GColor8 { uint8_t argb; } GColor8;
+typedef GColor8 GColor;
+#define GColorClear ((GColor8){.argb = 0x00})
+#define GColorBlack ((GColor8){.argb = 0xC0})
+#define GColorWhite ((GColor8){.argb = 0xFF})
+static inline bool gcolor_equal(GColor8 x, GColor8 y) { return x.argb == y.argb; }
+
+typedef enum {
+  GCompOpAssign, GCompOpAssignInverted, GCompOpOr, GCompOpAnd, GCompOpClear, GCompOpSet
+} GCompOp;
+
+typedef enum {
+  GCornerNone = 0, GCornersAll = 0xF
+} GCornerMask;
+
+/* bitmaps */
+typedef enum { GBitmapFormat1Bit = 0 } GBitmapFormat;
+typedef struct GBitmap GBitmap;
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format);
+void gbitmap_destroy(GBitmap *bitmap);
+uint8_t *gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+
+/* drawing */
+typedef struct GContext GContext;
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_draw_pixel(GContext *ctx, GPoint point);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void graphics_draw_rect(GContext *ctx, GRect rect);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius);
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+/* text */
+typedef struct StubFont *GFont;
+typedef struct GTextAttributes GTextAttributes;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill } GTextOverflowMode;
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+#define FONT_KEY_GOTHIC_14 "RESOURCE_ID_GOTHIC_14"
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_28_BOLD "RESOURCE_ID_GOTHIC_28_BOLD"
+GFont fonts_get_system_font(const char *font_key);
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        GTextAttributes *text_attributes);
+
+/* paths */
+typedef struct GPathInfo { uint32_t num_points; GPoint *points; } GPathInfo;
+typedef struct GPath { uint32_t num_points; GPoint *points; int32_t rotation; GPoint offset; } GPath;
+GPath *gpath_create(const GPathInfo *init);
+void gpath_destroy(GPath *path);
+void gpath_move_to(GPath *path, GPoint point);
+void gpath_rotate_to(GPath *path, int32_t angle);
+void gpath_draw_filled(GContext *ctx, GPath *path);
+void gpath_draw_outline(GContext *ctx, GPath *path);
+
+/* trig */
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+/* layers and windows */
+typedef struct Layer Layer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_remove_from_parent(Layer *child);
+void layer_mark_dirty(Layer *layer);
+GRect layer_get_bounds(const Layer *layer);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_hidden(Layer *layer, bool hidden);
+
+typedef void (*WindowHandler)(Window *window);
+typedef struct WindowHandlers {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+Layer *window_get_root_layer(const Window *window);
+void window_stack_push(Window *window, bool animated);
+
+/* services */
+typedef enum {
+  SECOND_UNIT = 1 << 0, MINUTE_UNIT = 1 << 1, HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3, MONTH_UNIT = 1 << 4, YEAR_UNIT = 1 << 5
+} TimeUnits;
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+bool clock_is_24h_style(void);
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+
+typedef enum { ACCEL_AXIS_X = 0, ACCEL_AXIS_Y = 1, ACCEL_AXIS_Z = 2 } AccelAxisType;
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms);
+void app_timer_cancel(AppTimer *timer_handle);
+
+typedef struct { uint8_t charge_percent; bool is_charging; bool is_plugged; } BatteryChargeState;
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+void battery_state_service_unsubscribe(void);
+BatteryChargeState battery_state_service_peek(void);
+
+/* persistent storage */
+#define PERSIST_DATA_MAX_LENGTH 256
+#define PERSIST_STRING_MAX_LENGTH PERSIST_DATA_MAX_LENGTH
+bool persist_exists(const uint32_t key);
+int persist_get_size(const uint32_t key);
+bool persist_read_bool(const uint32_t key);
+int32_t persist_read_int(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size);
+int persist_write_bool(const uint32_t key, const bool value);
+int persist_write_int(const uint32_t key, const int32_t value);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+int persist_write_string(const uint32_t key, const char *cstring);
+int persist_delete(const uint32_t key);
+
+/* resources; the ids come from appinfo.json (resource_ids.auto.h in the SDK) */
+#define RESOURCE_ID_CITY_TABLE 1
+typedef void *ResHandle;
+ResHandle resource_get_handle(uint32_t resource_id);
+size_t resource_size(ResHandle h);
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes);
+
+/* dictionaries and AppMessage */
+typedef enum { TUPLE_BYTE_ARRAY = 0, TUPLE_CSTRING = 1, TUPLE_UINT = 2, TUPLE_INT = 3 } TupleType;
+typedef struct __attribute__((__packed__)) Tuple {
+  uint32_t key;
+  TupleType type:8;
+  uint16_t length;
+  union {
+    uint8_t data[0];
+    char cstring[0];
+    uint8_t uint8;
+    uint16_t uint16;
+    uint32_t uint32;
+    int8_t int8;
+    int16_t int16;
+    int32_t int32;
+  } value[];
+} Tuple;
+typedef struct DictionaryIterator DictionaryIterator;
+typedef enum { DICT_OK = 0, DICT_NOT_ENOUGH_STORAGE = 1 << 1, DICT_INVALID_ARGS = 1 << 2 } DictionaryResult;
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
+Tuple *dict_read_first(DictionaryIterator *iter);
+Tuple *dict_read_next(DictionaryIterator *iter);
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size);
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring);
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed);
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value);
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value);
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value);
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value);
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value);
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value);
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...);
+
+typedef enum {
+  APP_MSG_OK = 0, APP_MSG_SEND_TIMEOUT = 1 << 1, APP_MSG_BUSY = 1 << 10,
+  APP_MSG_BUFFER_OVERFLOW = 1 << 11, APP_MSG_OUT_OF_MEMORY = 1 << 12
+} AppMessageResult;
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageInboxDropped)(AppMessageResult reason, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, void *context);
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+uint32_t app_message_inbox_size_maximum(void);
+uint32_t app_message_outbox_size_maximum(void);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+
+/* the event loop is provided by the harness */
+void app_event_loop(void);
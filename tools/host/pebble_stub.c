@@ -0,0 +1,1135 @@
+/*
+ * Host implementation of the Pebble SDK subset declared in pebble.h.
+ *
+ * Drawing goes to a real 1-bit frame buffer laid out like aplite's (LSB is
+ * the leftmost pixel, 20 bytes per row), so sprites captured with
+ * graphics_capture_frame_buffer behave as they do on the watch. Text has
+ * no fonts: each glyph is drawn as a solid box of roughly the right size,
+ * which is enough for counting pixels.
+ */
+#include <math.h>
+#include <stdarg.h>
+#include "stub.h"
+
+#define FB_ROW_BYTES 20
+
+bool stub_verbose = false;
+StubCallCounts stub_calls;
+
+/******************
+  CLOCK
+*******************/
+static time_t simulated_now;
+
+static uint64_t simulated_ms;  // the same clock, for app timers
+
+void stub_set_time(time_t now) {
+  simulated_now = now;
+  simulated_ms = (uint64_t)now * 1000;
+}
+
+time_t stub_get_time(void) {
+  return simulated_now;
+}
+
+time_t stub_time(time_t *t) {
+  if (t) *t = simulated_now;
+  return simulated_now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  // durations are what the app measures with this, so use the real clock.
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  uint16_t ms = ts.tv_nsec / 1000000;
+  if (tloc) *tloc = ts.tv_sec;
+  if (out_ms) *out_ms = ms;
+  return ms;
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  if (!stub_verbose) return;
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%s:%d] ", src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+/******************
+  GEOMETRY
+*******************/
+GPoint grect_center_point(const GRect *rect) {
+  return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+         point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+static GRect rect_intersect(GRect a, GRect b) {
+  int x0 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+  int y0 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+  int x1 = a.origin.x + a.size.w < b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+  int y1 = a.origin.y + a.size.h < b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+  if (x1 < x0) x1 = x0;
+  if (y1 < y0) y1 = y0;
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/******************
+  BITMAPS
+*******************/
+struct GBitmap {
+  uint8_t *addr;
+  uint16_t row_size_bytes;
+  GRect bounds;
+};
+
+static uint8_t fb_data[FB_ROW_BYTES * STUB_SCREEN_HEIGHT];
+static GBitmap frame_buffer = { fb_data, FB_ROW_BYTES, {{0, 0}, {STUB_SCREEN_WIDTH, STUB_SCREEN_HEIGHT}} };
+
+static bool rendering = false;
+static StubFrameStats *frame_stats = NULL;
+
+static void count_allocation(void) {
+  if (rendering && frame_stats) frame_stats->allocations++;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  count_allocation();
+  GBitmap *bitmap = calloc(1, sizeof(GBitmap));
+  bitmap->row_size_bytes = ((size.w + 31) / 32) * 4;
+  bitmap->addr = calloc(bitmap->row_size_bytes, size.h ? size.h : 1);
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap || bitmap == &frame_buffer) return;
+  free(bitmap->addr);
+  free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+  return bitmap->addr;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return bitmap->row_size_bytes;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+  return bitmap->bounds;
+}
+
+static bool bitmap_get(const GBitmap *bitmap, int x, int y) {
+  return (bitmap->addr[y * bitmap->row_size_bytes + x / 8] >> (x % 8)) & 1;
+}
+
+static void bitmap_set(GBitmap *bitmap, int x, int y, bool white) {
+  uint8_t *byte = &bitmap->addr[y * bitmap->row_size_bytes + x / 8];
+  if (white) *byte |= 1 << (x % 8);
+  else *byte &= ~(1 << (x % 8));
+}
+
+bool stub_write_pbm(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+  fprintf(f, "P1\n%d %d\n", STUB_SCREEN_WIDTH, STUB_SCREEN_HEIGHT);
+  for (int y = 0; y < STUB_SCREEN_HEIGHT; y++) {
+    for (int x = 0; x < STUB_SCREEN_WIDTH; x++) {
+      // PBM uses 1 for black
+      fputc(bitmap_get(&frame_buffer, x, y) ? '0' : '1', f);
+    }
+    fputc('\n', f);
+  }
+  fclose(f);
+  return true;
+}
+
+/******************
+  GRAPHICS CONTEXT
+*******************/
+struct GContext {
+  GPoint offset;         // screen position of the current layer
+  GRect clip;            // screen coordinates
+  GColor stroke;
+  GColor fill;
+  GColor text;
+  GCompOp compositing;
+  StubLayerStats *stats;
+  uint8_t captured[sizeof(fb_data)];
+  bool is_captured;
+};
+
+static GContext context;
+
+static bool is_white(GColor color) {
+  return color.argb == GColorWhite.argb;
+}
+
+static bool is_clear(GColor color) {
+  return (color.argb & 0xC0) == 0;
+}
+
+static void count_draw(GContext *ctx) {
+  stub_calls.graphics++;
+  if (ctx->stats) ctx->stats->draw_calls++;
+}
+
+static void count_path_draw(GContext *ctx) {
+  stub_calls.gpath++;
+  if (ctx->stats) ctx->stats->draw_calls++;
+}
+
+// x and y are in layer coordinates.
+static void put_pixel(GContext *ctx, int x, int y, GColor color) {
+  if (is_clear(color)) return;
+  x += ctx->offset.x;
+  y += ctx->offset.y;
+  GPoint p = GPoint(x, y);
+  if (!grect_contains_point(&ctx->clip, &p)) return;
+  bitmap_set(&frame_buffer, x, y, is_white(color));
+  if (ctx->stats) ctx->stats->pixels++;
+}
+
+static void put_span(GContext *ctx, int y, int x0, int x1, GColor color) {
+  for (int x = x0; x <= x1; x++) put_pixel(ctx, x, y, color);
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  stub_calls.graphics++;
+  ctx->stroke = color;
+}
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  stub_calls.graphics++;
+  ctx->fill = color;
+}
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  stub_calls.graphics++;
+  ctx->text = color;
+}
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  stub_calls.graphics++;
+  ctx->compositing = mode;
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  count_draw(ctx);
+  put_pixel(ctx, point.x, point.y, ctx->stroke);
+}
+
+static void draw_line(GContext *ctx, GPoint p0, GPoint p1, GColor color) {
+  int dx = abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+  int dy = -abs(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+  int err = dx + dy;
+  int x = p0.x, y = p0.y;
+  for (;;) {
+    put_pixel(ctx, x, y, color);
+    if (x == p1.x && y == p1.y) break;
+    int e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x += sx; }
+    if (e2 <= dx) { err += dx; y += sy; }
+  }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  count_draw(ctx);
+  draw_line(ctx, p0, p1, ctx->stroke);
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect) {
+  count_draw(ctx);
+  int x1 = rect.origin.x + rect.size.w - 1, y1 = rect.origin.y + rect.size.h - 1;
+  put_span(ctx, rect.origin.y, rect.origin.x, x1, ctx->stroke);
+  put_span(ctx, y1, rect.origin.x, x1, ctx->stroke);
+  for (int y = rect.origin.y; y <= y1; y++) {
+    put_pixel(ctx, rect.origin.x, y, ctx->stroke);
+    put_pixel(ctx, x1, y, ctx->stroke);
+  }
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  count_draw(ctx);
+  for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+    put_span(ctx, y, rect.origin.x, rect.origin.x + rect.size.w - 1, ctx->fill);
+  }
+}
+
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  count_draw(ctx);
+  int x = radius, y = 0, err = 1 - x;
+  while (x >= y) {
+    put_pixel(ctx, p.x + x, p.y + y, ctx->stroke);
+    put_pixel(ctx, p.x + y, p.y + x, ctx->stroke);
+    put_pixel(ctx, p.x - y, p.y + x, ctx->stroke);
+    put_pixel(ctx, p.x - x, p.y + y, ctx->stroke);
+    put_pixel(ctx, p.x - x, p.y - y, ctx->stroke);
+    put_pixel(ctx, p.x - y, p.y - x, ctx->stroke);
+    put_pixel(ctx, p.x + y, p.y - x, ctx->stroke);
+    put_pixel(ctx, p.x + x, p.y - y, ctx->stroke);
+    y++;
+    if (err < 0) {
+      err += 2 * y + 1;
+    } else {
+      x--;
+      err += 2 * (y - x) + 1;
+    }
+  }
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  count_draw(ctx);
+  int r_sq = radius * radius + radius;
+  for (int dy = -radius; dy <= radius; dy++) {
+    int half = (int)sqrt((double)(r_sq - dy * dy));
+    put_span(ctx, p.y + dy, p.x - half, p.x + half, ctx->fill);
+  }
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  count_draw(ctx);
+  int w = bitmap->bounds.size.w, h = bitmap->bounds.size.h;
+  if (w == 0 || h == 0) return;
+  for (int y = 0; y < rect.size.h; y++) {
+    for (int x = 0; x < rect.size.w; x++) {
+      int sx = rect.origin.x + x + ctx->offset.x, sy = rect.origin.y + y + ctx->offset.y;
+      GPoint sp = GPoint(sx, sy);
+      if (!grect_contains_point(&ctx->clip, &sp)) continue;
+      bool src = bitmap_get(bitmap, x % w, y % h);
+      bool dst = bitmap_get(&frame_buffer, sx, sy);
+      switch (ctx->compositing) {
+        case GCompOpAssign: dst = src; break;
+        case GCompOpAssignInverted: dst = !src; break;
+        case GCompOpOr: dst = dst || src; break;
+        case GCompOpAnd: dst = dst && src; break;
+        case GCompOpClear: dst = dst && !src; break;
+        case GCompOpSet: dst = dst || !src; break;
+      }
+      bitmap_set(&frame_buffer, sx, sy, dst);
+      if (ctx->stats) ctx->stats->pixels++;
+    }
+  }
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  if (ctx->is_captured) return NULL;
+  count_draw(ctx);
+  memcpy(ctx->captured, fb_data, sizeof(fb_data));
+  ctx->is_captured = true;
+  return &frame_buffer;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  if (!ctx->is_captured || buffer != &frame_buffer) return false;
+  // direct writes can't be seen one by one; count the pixels that changed.
+  if (ctx->stats) {
+    for (size_t i = 0; i < sizeof(fb_data); i++) {
+      ctx->stats->pixels += __builtin_popcount(ctx->captured[i] ^ fb_data[i]);
+    }
+  }
+  ctx->is_captured = false;
+  return true;
+}
+
+/******************
+  TEXT
+*******************/
+struct StubFont {
+  const char *key;
+  int advance;      // pixels per glyph
+  int glyph_height;
+  int top;          // blank rows above the glyphs
+};
+
+static struct StubFont fonts[] = {
+  { FONT_KEY_GOTHIC_14, 6, 9, 5 },
+  { FONT_KEY_GOTHIC_18_BOLD, 8, 12, 6 },
+  { FONT_KEY_GOTHIC_28_BOLD, 13, 18, 9 },
+};
+
+GFont fonts_get_system_font(const char *font_key) {
+  for (size_t i = 0; i < sizeof(fonts) / sizeof(fonts[0]); i++) {
+    if (strcmp(fonts[i].key, font_key) == 0) return &fonts[i];
+  }
+  return &fonts[0];
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        GTextAttributes *text_attributes) {
+  count_draw(ctx);
+  int width = strlen(text) * font->advance;
+  int x = box.origin.x;
+  if (alignment == GTextAlignmentCenter) x += (box.size.w - width) / 2;
+  if (alignment == GTextAlignmentRight) x += box.size.w - width;
+  int y = box.origin.y + font->top;
+  if (font->top + font->glyph_height > box.size.h) return;  // line doesn't fit
+  for (const char *c = text; *c; c++, x += font->advance) {
+    if (*c == ' ') continue;
+    for (int gy = 0; gy < font->glyph_height; gy++) {
+      put_span(ctx, y + gy, x, x + font->advance - 2, ctx->text);
+    }
+  }
+}
+
+/******************
+  PATHS
+*******************/
+int32_t sin_lookup(int32_t angle) {
+  return (int32_t)lround(sin(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return (int32_t)lround(cos(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+  double a = atan2(y, x);
+  if (a < 0) a += 2 * M_PI;
+  return (int32_t)lround(a * TRIG_MAX_ANGLE / (2 * M_PI)) & (TRIG_MAX_ANGLE - 1);
+}
+
+GPath *gpath_create(const GPathInfo *init) {
+  stub_calls.gpath++;
+  count_allocation();
+  GPath *path = calloc(1, sizeof(GPath));
+  path->num_points = init->num_points;
+  path->points = init->points;
+  return path;
+}
+
+void gpath_destroy(GPath *path) {
+  stub_calls.gpath++;
+  free(path);
+}
+
+void gpath_move_to(GPath *path, GPoint point) {
+  stub_calls.gpath++;
+  path->offset = point;
+}
+
+void gpath_rotate_to(GPath *path, int32_t angle) {
+  stub_calls.gpath++;
+  path->rotation = angle;
+}
+
+static GPoint path_point(const GPath *path, uint32_t i) {
+  int32_t s = sin_lookup(path->rotation), c = cos_lookup(path->rotation);
+  GPoint p = path->points[i];
+  return GPoint((p.x * c - p.y * s) / TRIG_MAX_RATIO + path->offset.x,
+                (p.x * s + p.y * c) / TRIG_MAX_RATIO + path->offset.y);
+}
+
+void gpath_draw_filled(GContext *ctx, GPath *path) {
+  count_path_draw(ctx);
+  if (path->num_points < 3) return;
+  GPoint pts[path->num_points];
+  int y_min = INT16_MAX, y_max = INT16_MIN;
+  for (uint32_t i = 0; i < path->num_points; i++) {
+    pts[i] = path_point(path, i);
+    if (pts[i].y < y_min) y_min = pts[i].y;
+    if (pts[i].y > y_max) y_max = pts[i].y;
+  }
+  // even-odd scanline fill, sampling each row at its centre.
+  for (int y = y_min; y <= y_max; y++) {
+    int xs[path->num_points];
+    int n = 0;
+    for (uint32_t i = 0; i < path->num_points; i++) {
+      GPoint a = pts[i], b = pts[(i + 1) % path->num_points];
+      if ((a.y <= y && b.y > y) || (b.y <= y && a.y > y)) {
+        xs[n++] = a.x + (int)lround((double)(y - a.y) * (b.x - a.x) / (b.y - a.y));
+      }
+    }
+    for (int i = 1; i < n; i++) {
+      for (int j = i; j > 0 && xs[j - 1] > xs[j]; j--) {
+        int t = xs[j]; xs[j] = xs[j - 1]; xs[j - 1] = t;
+      }
+    }
+    for (int i = 0; i + 1 < n; i += 2) put_span(ctx, y, xs[i], xs[i + 1], ctx->fill);
+  }
+}
+
+void gpath_draw_outline(GContext *ctx, GPath *path) {
+  count_path_draw(ctx);
+  for (uint32_t i = 0; i < path->num_points; i++) {
+    draw_line(ctx, path_point(path, i), path_point(path, (i + 1) % path->num_points), ctx->stroke);
+  }
+}
+
+/******************
+  LAYERS AND WINDOWS
+*******************/
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  bool hidden;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+static Window *top_window = NULL;
+static bool dirty = false;
+
+Layer *layer_create(GRect frame) {
+  stub_calls.layer++;
+  count_allocation();
+  Layer *layer = calloc(1, sizeof(Layer));
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  return layer;
+}
+
+void layer_destroy(Layer *layer) {
+  stub_calls.layer++;
+  if (!layer) return;
+  layer_remove_from_parent(layer);
+  free(layer);
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  stub_calls.layer++;
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  stub_calls.layer++;
+  child->parent = parent;
+  child->next_sibling = NULL;
+  Layer **link = &parent->first_child;
+  while (*link) link = &(*link)->next_sibling;
+  *link = child;
+  dirty = true;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  stub_calls.layer++;
+  if (!child->parent) return;
+  Layer **link = &child->parent->first_child;
+  while (*link && *link != child) link = &(*link)->next_sibling;
+  if (*link) *link = child->next_sibling;
+  child->parent = NULL;
+  dirty = true;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  stub_calls.layer++;
+  // like the firmware, any dirty layer means the whole window is redrawn.
+  dirty = true;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  stub_calls.layer++;
+  return layer->bounds;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  stub_calls.layer++;
+  return layer->frame;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  stub_calls.layer++;
+  layer->hidden = hidden;
+  dirty = true;
+}
+
+Window *window_create(void) {
+  count_allocation();
+  Window *window = calloc(1, sizeof(Window));
+  window->root.frame = GRect(0, 0, STUB_SCREEN_WIDTH, STUB_SCREEN_HEIGHT);
+  window->root.bounds = window->root.frame;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (window->loaded && window->handlers.unload) window->handlers.unload(window);
+  if (top_window == window) top_window = NULL;
+  free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return (Layer *)&window->root;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  top_window = window;
+  if (!window->loaded && window->handlers.load) window->handlers.load(window);
+  window->loaded = true;
+  if (window->handlers.appear) window->handlers.appear(window);
+  dirty = true;
+}
+
+static void render_layer(Layer *layer, GPoint origin, GRect clip, StubFrameStats *stats) {
+  if (layer->hidden) return;
+  origin.x += layer->frame.origin.x;
+  origin.y += layer->frame.origin.y;
+  clip = rect_intersect(clip, GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h));
+
+  if (layer->update_proc) {
+    StubLayerStats *layer_stats = NULL;
+    if (stats->layer_count < STUB_MAX_LAYERS) {
+      layer_stats = &stats->layers[stats->layer_count++];
+      memset(layer_stats, 0, sizeof(*layer_stats));
+      layer_stats->frame = GRect(origin.x, origin.y, layer->frame.size.w, layer->frame.size.h);
+    }
+    context.offset = origin;
+    context.clip = clip;
+    context.stroke = GColorBlack;
+    context.fill = GColorBlack;
+    context.text = GColorBlack;
+    context.compositing = GCompOpAssign;
+    context.stats = layer_stats;
+    uint64_t start = now_ns();
+    layer->update_proc(layer, &context);
+    if (layer_stats) layer_stats->nanoseconds = now_ns() - start;
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+    render_layer(child, origin, clip, stats);
+  }
+}
+
+bool stub_render(StubFrameStats *stats) {
+  if (!dirty || !top_window) return false;
+  memset(stats, 0, sizeof(*stats));
+  frame_stats = stats;
+  rendering = true;
+  dirty = false;
+
+  uint64_t start = now_ns();
+  memset(fb_data, 0xFF, sizeof(fb_data));  // white window background
+  render_layer(&top_window->root, GPointZero, top_window->root.frame, stats);
+  stats->nanoseconds = now_ns() - start;
+
+  rendering = false;
+  frame_stats = NULL;
+  return true;
+}
+
+/******************
+  SERVICES
+*******************/
+static TickHandler tick_handler = NULL;
+static TimeUnits tick_units = 0;
+static BatteryStateHandler battery_handler = NULL;
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler) {
+  tick_units = units;
+  tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+  tick_units = 0;
+  tick_handler = NULL;
+}
+
+TimeUnits stub_tick_units(void) {
+  return tick_units;
+}
+
+void stub_tick(struct tm *tick_time, TimeUnits units_changed) {
+  if (tick_handler) tick_handler(tick_time, units_changed);
+}
+
+static AccelTapHandler tap_handler = NULL;
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  tap_handler = NULL;
+}
+
+void stub_tap(void) {
+  if (tap_handler) tap_handler(ACCEL_AXIS_Y, 1);
+}
+
+/******************
+  APP TIMERS
+*******************/
+// timers run on the simulated clock, in milliseconds.
+struct AppTimer {
+  uint64_t due;
+  AppTimerCallback callback;
+  void *data;
+  AppTimer *next;
+};
+
+static AppTimer *timers = NULL;
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  count_allocation();
+  AppTimer *timer = calloc(1, sizeof(AppTimer));
+  timer->due = simulated_ms + timeout_ms;
+  timer->callback = callback;
+  timer->data = callback_data;
+  timer->next = timers;
+  timers = timer;
+  return timer;
+}
+
+static bool timer_unlink(AppTimer *timer) {
+  for (AppTimer **link = &timers; *link; link = &(*link)->next) {
+    if (*link == timer) {
+      *link = timer->next;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool app_timer_reschedule(AppTimer *timer, uint32_t new_timeout_ms) {
+  for (AppTimer *t = timers; t; t = t->next) {
+    if (t == timer) {
+      timer->due = simulated_ms + new_timeout_ms;
+      return true;
+    }
+  }
+  return false;
+}
+
+void app_timer_cancel(AppTimer *timer) {
+  if (timer_unlink(timer)) free(timer);
+}
+
+void stub_advance_to(time_t now) {
+  uint64_t end = (uint64_t)now * 1000;
+  for (;;) {
+    AppTimer *first = NULL;
+    for (AppTimer *t = timers; t; t = t->next) {
+      if (!first || t->due < first->due) first = t;
+    }
+    if (!first || first->due > end) break;
+    timer_unlink(first);
+    simulated_ms = first->due;
+    simulated_now = first->due / 1000;
+    first->callback(first->data);
+    free(first);
+  }
+  simulated_ms = end;
+  simulated_now = now;
+}
+
+bool clock_is_24h_style(void) {
+  return true;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+  return (BatteryChargeState) { .charge_percent = 80, .is_charging = false, .is_plugged = false };
+}
+
+/******************
+  PERSISTENT STORAGE
+*******************/
+#define PERSIST_SLOTS 64
+
+static struct {
+  bool used;
+  uint32_t key;
+  int size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} persist[PERSIST_SLOTS];
+
+static int persist_find(uint32_t key) {
+  for (int i = 0; i < PERSIST_SLOTS; i++) {
+    if (persist[i].used && persist[i].key == key) return i;
+  }
+  return -1;
+}
+
+bool persist_exists(const uint32_t key) {
+  stub_calls.persist++;
+  return persist_find(key) >= 0;
+}
+
+int persist_get_size(const uint32_t key) {
+  stub_calls.persist++;
+  int i = persist_find(key);
+  return i < 0 ? -1 : persist[i].size;
+}
+
+static int read_data(uint32_t key, void *buffer, size_t buffer_size) {
+  int i = persist_find(key);
+  if (i < 0) return -1;
+  int size = (size_t)persist[i].size < buffer_size ? persist[i].size : (int)buffer_size;
+  memcpy(buffer, persist[i].data, size);
+  return size;
+}
+
+static int write_data(uint32_t key, const void *data, size_t size) {
+  int i = persist_find(key);
+  if (i < 0) {
+    for (i = 0; i < PERSIST_SLOTS && persist[i].used; i++);
+    if (i == PERSIST_SLOTS) return -1;
+  }
+  int n = size < PERSIST_DATA_MAX_LENGTH ? (int)size : PERSIST_DATA_MAX_LENGTH;
+  persist[i].used = true;
+  persist[i].key = key;
+  persist[i].size = n;
+  memcpy(persist[i].data, data, n);
+  return n;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  stub_calls.persist++;
+  return read_data(key, buffer, buffer_size);
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  stub_calls.persist++;
+  return write_data(key, data, size);
+}
+
+// the store is saved as-is; the file only has to survive between two runs
+// of the same binary.
+bool stub_persist_load(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return false;
+  bool ok = fread(persist, sizeof(persist), 1, file) == 1;
+  fclose(file);
+  if (!ok) memset(persist, 0, sizeof(persist));
+  return ok;
+}
+
+bool stub_persist_save(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) return false;
+  bool ok = fwrite(persist, sizeof(persist), 1, file) == 1;
+  return fclose(file) == 0 && ok;
+}
+
+/******************
+  RESOURCES
+*******************/
+// the app's resources are read straight from the source tree, which the
+// Makefile passes in as STUB_RESOURCE_DIR.
+#ifndef STUB_RESOURCE_DIR
+#define STUB_RESOURCE_DIR "../../resources"
+#endif
+
+static const char *resource_files[] = {
+  [RESOURCE_ID_CITY_TABLE] = "data/cities.bin",
+};
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+} StubResource;
+
+static StubResource resources[sizeof(resource_files) / sizeof(resource_files[0])];
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+  stub_calls.resource++;
+  if (resource_id >= sizeof(resource_files) / sizeof(resource_files[0]) || !resource_files[resource_id]) {
+    return NULL;
+  }
+  if (!resources[resource_id].data) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", STUB_RESOURCE_DIR, resource_files[resource_id]);
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+      fprintf(stderr, "can't read resource %s\n", path);
+      return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    resources[resource_id].data = malloc(size > 0 ? size : 1);
+    resources[resource_id].size = fread(resources[resource_id].data, 1, size > 0 ? size : 0, file);
+    fclose(file);
+  }
+  return &resources[resource_id];
+}
+
+size_t resource_size(ResHandle h) {
+  stub_calls.resource++;
+  return h ? ((StubResource *)h)->size : 0;
+}
+
+size_t resource_load_byte_range(ResHandle h, uint32_t start_offset, uint8_t *buffer, size_t num_bytes) {
+  stub_calls.resource++;
+  if (!h) return 0;
+  StubResource *resource = h;
+  if (start_offset >= resource->size) return 0;
+  if (num_bytes > resource->size - start_offset) num_bytes = resource->size - start_offset;
+  memcpy(buffer, resource->data + start_offset, num_bytes);
+  return num_bytes;
+}
+
+bool persist_read_bool(const uint32_t key) {
+  stub_calls.persist++;
+  bool value = false;
+  read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  stub_calls.persist++;
+  int32_t value = 0;
+  read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_read_string(const uint32_t key, char *buffer, const size_t buffer_size) {
+  stub_calls.persist++;
+  int n = read_data(key, buffer, buffer_size);
+  if (n > 0) buffer[n - 1] = '\0';
+  return n;
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+  stub_calls.persist++;
+  return write_data(key, &value, sizeof(value));
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  stub_calls.persist++;
+  return write_data(key, &value, sizeof(value));
+}
+
+int persist_write_string(const uint32_t key, const char *cstring) {
+  stub_calls.persist++;
+  return write_data(key, cstring, strlen(cstring) + 1);
+}
+
+int persist_delete(const uint32_t key) {
+  stub_calls.persist++;
+  int i = persist_find(key);
+  if (i >= 0) persist[i].used = false;
+  return 0;
+}
+
+/******************
+  DICTIONARIES
+*******************/
+#define DICT_BUFFER_SIZE 2048
+#define TUPLE_HEADER_SIZE 7
+
+struct DictionaryIterator {
+  uint8_t buffer[DICT_BUFFER_SIZE];
+  size_t used;
+  uint8_t count;
+  size_t cursor;
+};
+
+static void dict_reset(DictionaryIterator *iter) {
+  iter->used = 1;  // the first byte holds the tuple count
+  iter->count = 0;
+  iter->cursor = 1;
+}
+
+static uint32_t dict_size(const DictionaryIterator *iter) {
+  return iter->used;
+}
+
+static DictionaryResult dict_append(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t length) {
+  if (iter->used + TUPLE_HEADER_SIZE + length > DICT_BUFFER_SIZE) return DICT_NOT_ENOUGH_STORAGE;
+  Tuple *tuple = (Tuple *)&iter->buffer[iter->used];
+  tuple->key = key;
+  tuple->type = type;
+  tuple->length = length;
+  memcpy(tuple->value, data, length);
+  iter->used += TUPLE_HEADER_SIZE + length;
+  iter->buffer[0] = ++iter->count;
+  return DICT_OK;
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  iter->cursor = 1;
+  return dict_read_next(iter);
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  if (iter->cursor >= iter->used) return NULL;
+  Tuple *tuple = (Tuple *)&iter->buffer[iter->cursor];
+  iter->cursor += TUPLE_HEADER_SIZE + tuple->length;
+  return tuple;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  size_t cursor = 1;
+  while (cursor < iter->used) {
+    Tuple *tuple = (Tuple *)&iter->buffer[cursor];
+    if (tuple->key == key) return tuple;
+    cursor += TUPLE_HEADER_SIZE + tuple->length;
+  }
+  return NULL;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size) {
+  return dict_append(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char * const cstring) {
+  return dict_append(iter, key, TUPLE_CSTRING, cstring, strlen(cstring) + 1);
+}
+
+DictionaryResult dict_write_int(DictionaryIterator *iter, const uint32_t key, const void *integer, const uint8_t width_bytes, const bool is_signed) {
+  return dict_append(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT, integer, width_bytes);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+  return dict_write_int(iter, key, &value, 1, false);
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value) {
+  return dict_write_int(iter, key, &value, 2, false);
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) {
+  return dict_write_int(iter, key, &value, 4, false);
+}
+
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value) {
+  return dict_write_int(iter, key, &value, 1, true);
+}
+
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value) {
+  return dict_write_int(iter, key, &value, 2, true);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+  return dict_write_int(iter, key, &value, 4, true);
+}
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  va_list args;
+  va_start(args, tuple_count);
+  uint32_t size = 1;
+  for (int i = 0; i < tuple_count; i++) {
+    size += TUPLE_HEADER_SIZE + va_arg(args, uint32_t);
+  }
+  va_end(args);
+  return size;
+}
+
+/******************
+  APPMESSAGE
+*******************/
+static AppMessageInboxReceived inbox_received = NULL;
+static AppMessageInboxDropped inbox_dropped = NULL;
+static AppMessageOutboxSent outbox_sent = NULL;
+static AppMessageOutboxFailed outbox_failed = NULL;
+static uint32_t inbox_size = 0;
+static uint32_t outbox_size = 0;
+static DictionaryIterator inbox;
+static DictionaryIterator outbox;
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived callback) {
+  AppMessageInboxReceived old = inbox_received;
+  inbox_received = callback;
+  return old;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped callback) {
+  AppMessageInboxDropped old = inbox_dropped;
+  inbox_dropped = callback;
+  return old;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent callback) {
+  AppMessageOutboxSent old = outbox_sent;
+  outbox_sent = callback;
+  return old;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed callback) {
+  AppMessageOutboxFailed old = outbox_failed;
+  outbox_failed = callback;
+  return old;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  inbox_size = size_inbound;
+  outbox_size = size_outbound;
+  return APP_MSG_OK;
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return 8200;
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return 8200;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  dict_reset(&outbox);
+  *iterator = &outbox;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  if (dict_size(&outbox) > outbox_size) {
+    if (outbox_failed) outbox_failed(&outbox, APP_MSG_BUFFER_OVERFLOW, NULL);
+    return APP_MSG_BUFFER_OVERFLOW;
+  }
+  printf("outbox:");
+  for (Tuple *t = dict_read_first(&outbox); t; t = dict_read_next(&outbox)) {
+    if (t->type == TUPLE_INT || t->type == TUPLE_UINT) {
+      int32_t v = t->length == 1 ? t->value->int8 : t->length == 2 ? t->value->int16 : t->value->int32;
+      printf(" %u=%d", (unsigned)t->key, (int)v);
+    } else if (t->type == TUPLE_CSTRING) {
+      printf(" %u=\"%s\"", (unsigned)t->key, t->value->cstring);
+    } else {
+      printf(" %u=<%u bytes>", (unsigned)t->key, (unsigned)t->length);
+    }
+  }
+  printf("\n");
+  if (outbox_sent) outbox_sent(&outbox, NULL);
+  return APP_MSG_OK;
+}
+
+void stub_inbox_begin(void) {
+  dict_reset(&inbox);
+}
+
+void stub_inbox_add_cstring(uint32_t key, const char *value) {
+  dict_write_cstring(&inbox, key, value);
+}
+
+void stub_inbox_add_int32(uint32_t key, int32_t value) {
+  dict_write_int32(&inbox, key, value);
+}
+
+void stub_inbox_add_data(uint32_t key, const uint8_t *data, uint16_t length) {
+  dict_write_data(&inbox, key, data, length);
+}
+
+void stub_inbox_deliver(void) {
+  if (dict_size(&inbox) > inbox_size) {
+    if (inbox_dropped) inbox_dropped(APP_MSG_BUFFER_OVERFLOW, NULL);
+    return;
+  }
+  if (inbox_received) inbox_received(&inbox, NULL);
+}
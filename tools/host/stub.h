@@ -0,0 +1,66 @@
+/*
+ * Harness-side interface to the Pebble stub: the simulated clock, the
+ * frame buffer, the render loop and the per-layer counters.
+ */
+#pragma once
+#include "pebble.h"
+
+#define STUB_SCREEN_WIDTH 144
+#define STUB_SCREEN_HEIGHT 168
+#define STUB_MAX_LAYERS 16
+
+typedef struct {
+  GRect frame;           // in screen coordinates
+  uint64_t nanoseconds;  // wall time spent in the update proc
+  uint32_t draw_calls;   // graphics_*, gpath_draw_* and bitmap draws
+  uint32_t pixels;       // frame buffer writes
+} StubLayerStats;
+
+typedef struct {
+  int layer_count;
+  StubLayerStats layers[STUB_MAX_LAYERS];
+  uint64_t nanoseconds;
+  uint32_t allocations;  // SDK objects created while rendering
+} StubFrameStats;
+
+// every SDK call the app made, by family
+typedef struct {
+  uint32_t graphics;
+  uint32_t gpath;
+  uint32_t layer;
+  uint32_t persist;
+  uint32_t resource;
+} StubCallCounts;
+
+extern bool stub_verbose;
+extern StubCallCounts stub_calls;
+
+// simulated clock. stub_advance_to fires the app timers that fall due
+// on the way.
+void stub_set_time(time_t now);
+time_t stub_get_time(void);
+void stub_advance_to(time_t now);
+
+// a wrist flick
+void stub_tap(void);
+
+// tick subscription, as set up by the app
+TimeUnits stub_tick_units(void);
+void stub_tick(struct tm *tick_time, TimeUnits units_changed);
+
+// renders the top window if anything is dirty; returns false otherwise.
+bool stub_render(StubFrameStats *stats);
+
+// AppMessage from the "phone": begin, add tuples, deliver.
+void stub_inbox_begin(void);
+void stub_inbox_add_cstring(uint32_t key, const char *value);
+void stub_inbox_add_int32(uint32_t key, int32_t value);
+void stub_inbox_add_data(uint32_t key, const uint8_t *data, uint16_t length);
+void stub_inbox_deliver(void);
+
+// writes the frame buffer as a plain PBM image.
+bool stub_write_pbm(const char *path);
+
+// persistent storage kept in a file, to run a cold start after a warm one.
+bool stub_persist_load(const char *path);
+bool stub_persist_save(const char *path);
@@ -0,0 +1,318 @@
+/*
+ * Bulk sun table generator: sunrise/sunset (and optionally the twilights)
+ * for many locations over a run of days, with the watch's own calcSun, so
+ * a table made here matches what the watch would compute.
+ *
+ *   ./sun-table-gen [--locations FILE | --grid DEGREES] [--start YYYY-MM-DD]
+ *                   [--days N] [--levels 1-4] [--threads N] [-o FILE]
+ *
+ * FILE has one "latitude longitude" per line; anything after them, and
+ * lines starting with '#', are ignored. --grid covers the world in steps
+ * of DEGREES instead, which is what the benchmark uses. The throughput,
+ * in rows (one location for one day) per second, goes to stderr.
+ *
+ * Output format, all little-endian:
+ *
+ *   offset  size  header
+ *        0     4  magic "SUNT"
+ *        4     2  version, 1
+ *        6     1  levels: 1 is sunrise/sunset only, then civil, nautical
+ *                 and astronomical twilight
+ *        7     1  0
+ *        8     4  locations
+ *       12     4  first day, in days since 1970-01-01
+ *       16     4  days
+ *       20     4  offset of the first row
+ *
+ *   then `locations' pairs of int32 latitude, longitude in micro-degrees,
+ *   then `locations' x `days' rows, location-major. A row is `levels'
+ *   pairs of uint16 rise, set in minutes after 00:00 UT, 0xFFFF when the
+ *   sun doesn't cross that zenith that day: with one level, exactly the
+ *   rows of src/sun_table.h.
+ *
+ * Work is split into blocks of rows. Each block is solved from
+ * structure-of-arrays inputs (one array per field) by one of --threads
+ * workers, which defaults to every online core.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "suncalc.h"
+
+#define FORMAT_VERSION 1
+#define HEADER_SIZE 24
+#define NO_EVENT 0xFFFF
+// rows per block; the inputs for one fit in L1
+#define BLOCK_ROWS 1024
+
+// the zeniths of each level, as the watch uses them (see src/ephemeris.c).
+static const float zeniths[SUNCALC_MAX_ZENITHS] = {
+  91.0f, ZENITH_CIVIL, ZENITH_NAUTICAL, ZENITH_ASTRONOMICAL
+};
+
+/*
+ * A batch of (latitude, longitude, date) tuples as structure of arrays;
+ * tuple i is latitude[i], longitude[i], year[i]-month[i]-mday[i]. The
+ * results go to `rows' in the file's row format.
+ */
+typedef struct {
+  size_t count;
+  int levels;
+  const float *latitude;
+  const float *longitude;
+  const int16_t *year;     // tm_year, as calcSun takes it
+  const uint8_t *month;    // 1-12
+  const uint8_t *mday;
+  uint8_t *rows;           // count * levels * 4 bytes
+} SunBatch;
+
+typedef struct {
+  float latitude;
+  float longitude;
+} Location;
+
+typedef struct {
+  const Location *locations;
+  size_t location_count;
+  int32_t start_day;
+  int days;
+  int levels;
+  uint8_t *rows;
+  size_t next_block;       // shared; taken with __atomic_fetch_add
+  size_t block_count;
+} Job;
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, v & 0xffff);
+  put_u16(p + 2, v >> 16);
+}
+
+static uint16_t event_minutes(float hours, bool polar) {
+  return polar ? NO_EVENT : (uint16_t)(lroundf(hours * 60) % 1440);
+}
+
+// the civil date of `days' since 1970-01-01 (the inverse of
+// days_from_civil in src/sun_table.c).
+static void civil_from_days(int32_t days, int *year, int *month, int *day) {
+  days += 719468;
+  int era = (days >= 0 ? days : days - 146096) / 146097;
+  int doe = days - era * 146097;
+  int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int mp = (5 * doy + 2) / 153;
+  *day = doy - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = yoe + era * 400 + (*month <= 2);
+}
+
+static void sun_batch_solve(const SunBatch *batch) {
+  for (size_t i = 0; i < batch->count; i++) {
+    SunEvents events;
+    calcSunEvents(batch->year[i], batch->month[i], batch->mday[i], batch->latitude[i],
+                  batch->longitude[i], zeniths, batch->levels, &events);
+    uint8_t *row = batch->rows + i * batch->levels * 4;
+    for (int level = 0; level < batch->levels; level++) {
+      bool polar = events.polar[level] != SUNCALC_CROSSES;
+      put_u16(row + level * 4, event_minutes(events.rise[level], polar));
+      put_u16(row + level * 4 + 2, event_minutes(events.set[level], polar));
+    }
+  }
+}
+
+static void *worker(void *data) {
+  Job *job = data;
+  float latitude[BLOCK_ROWS], longitude[BLOCK_ROWS];
+  int16_t year[BLOCK_ROWS];
+  uint8_t month[BLOCK_ROWS], mday[BLOCK_ROWS];
+  size_t total = job->location_count * job->days;
+
+  for (;;) {
+    size_t block = __atomic_fetch_add(&job->next_block, 1, __ATOMIC_RELAXED);
+    if (block >= job->block_count) break;
+    size_t first = block * BLOCK_ROWS;
+    size_t count = (total - first < BLOCK_ROWS) ? total - first : BLOCK_ROWS;
+
+    for (size_t i = 0; i < count; i++) {
+      size_t row = first + i;
+      const Location *location = &job->locations[row / job->days];
+      int y, m, d;
+      civil_from_days(job->start_day + (int32_t)(row % job->days), &y, &m, &d);
+      latitude[i] = location->latitude;
+      longitude[i] = location->longitude;
+      year[i] = y - 1900;
+      month[i] = m;
+      mday[i] = d;
+    }
+    SunBatch batch = {
+      .count = count, .levels = job->levels,
+      .latitude = latitude, .longitude = longitude,
+      .year = year, .month = month, .mday = mday,
+      .rows = job->rows + first * job->levels * 4,
+    };
+    sun_batch_solve(&batch);
+  }
+  return NULL;
+}
+
+static Location *read_locations(const char *path, size_t *count) {
+  FILE *f = fopen(path, "r");
+  if (!f) return NULL;
+  size_t capacity = 256;
+  Location *locations = malloc(capacity * sizeof(Location));
+  char line[256];
+  *count = 0;
+  while (locations && fgets(line, sizeof(line), f)) {
+    Location location;
+    if (line[0] == '#' || sscanf(line, "%f %f", &location.latitude, &location.longitude) != 2) {
+      continue;
+    }
+    if (*count == capacity) {
+      capacity *= 2;
+      locations = realloc(locations, capacity * sizeof(Location));
+      if (!locations) break;
+    }
+    locations[(*count)++] = location;
+  }
+  fclose(f);
+  return locations;
+}
+
+static Location *grid_locations(float step, size_t *count) {
+  int lats = (int)(180 / step) + 1, lons = (int)(360 / step);
+  Location *locations = malloc((size_t)lats * lons * sizeof(Location));
+  *count = 0;
+  for (int i = 0; locations && i < lats; i++) {
+    for (int j = 0; j < lons; j++) {
+      locations[(*count)++] = (Location) { -90 + i * step, -180 + j * step };
+    }
+  }
+  return locations;
+}
+
+static int32_t days_from_civil(int year, int month, int day) {
+  year -= month <= 2;
+  int era = (year >= 0 ? year : year - 399) / 400;
+  int yoe = year - era * 400;
+  int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static bool write_table(const char *path, const Job *job) {
+  FILE *f = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+  if (!f) return false;
+
+  uint8_t header[HEADER_SIZE] = { 'S', 'U', 'N', 'T' };
+  put_u16(header + 4, FORMAT_VERSION);
+  header[6] = job->levels;
+  put_u32(header + 8, job->location_count);
+  put_u32(header + 12, (uint32_t)job->start_day);
+  put_u32(header + 16, job->days);
+  put_u32(header + 20, HEADER_SIZE + job->location_count * 8);
+  bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+
+  for (size_t i = 0; ok && i < job->location_count; i++) {
+    uint8_t position[8];
+    put_u32(position, (uint32_t)(int32_t)lroundf(job->locations[i].latitude * 1000000));
+    put_u32(position + 4, (uint32_t)(int32_t)lroundf(job->locations[i].longitude * 1000000));
+    ok = fwrite(position, sizeof(position), 1, f) == 1;
+  }
+  size_t size = job->location_count * job->days * job->levels * 4;
+  ok = ok && fwrite(job->rows, 1, size, f) == size;
+
+  if (f != stdout) ok = (fclose(f) == 0) && ok;
+  return ok;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [--locations FILE | --grid DEGREES] [--start YYYY-MM-DD] [--days N]\n"
+                  "       [--levels 1-4] [--threads N] [-o FILE]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *locations_path = NULL, *output_path = NULL;
+  float grid = 0;
+  int year = 2025, month = 1, day = 1;
+  int days = 366, levels = 1;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (strcmp(arg, "--locations") == 0 && has_value) locations_path = argv[++i];
+    else if (strcmp(arg, "--grid") == 0 && has_value) grid = atof(argv[++i]);
+    else if (strcmp(arg, "--start") == 0 && has_value) {
+      if (sscanf(argv[++i], "%d-%d-%d", &year, &month, &day) != 3) usage(argv[0]);
+    }
+    else if (strcmp(arg, "--days") == 0 && has_value) days = atoi(argv[++i]);
+    else if (strcmp(arg, "--levels") == 0 && has_value) levels = atoi(argv[++i]);
+    else if (strcmp(arg, "--threads") == 0 && has_value) threads = atol(argv[++i]);
+    else if (strcmp(arg, "-o") == 0 && has_value) output_path = argv[++i];
+    else usage(argv[0]);
+  }
+  if ((locations_path == NULL) == (grid <= 0) || days <= 0 ||
+      levels < 1 || levels > SUNCALC_MAX_ZENITHS) {
+    usage(argv[0]);
+  }
+  if (threads < 1) threads = 1;
+
+  Job job = { .start_day = days_from_civil(year, month, day), .days = days, .levels = levels };
+  job.locations = locations_path ? read_locations(locations_path, &job.location_count)
+                                 : grid_locations(grid, &job.location_count);
+  if (!job.locations) {
+    fprintf(stderr, "can't read %s\n", locations_path ? locations_path : "the grid");
+    return 1;
+  }
+  size_t rows = job.location_count * days;
+  job.block_count = (rows + BLOCK_ROWS - 1) / BLOCK_ROWS;
+  job.rows = malloc(rows * levels * 4 + 1);
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  if (!job.rows || !workers) {
+    fprintf(stderr, "out of memory for %zu rows\n", rows);
+    return 1;
+  }
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  // the workers share the blocks, so any that did start finish the job;
+  // if none did, this thread does it alone.
+  long started = 0;
+  while (started < threads && pthread_create(&workers[started], NULL, worker, &job) == 0) {
+    started++;
+  }
+  if (started < threads) {
+    fprintf(stderr, "started only %ld of %ld threads\n", started, threads);
+  }
+  if (started == 0) {
+    worker(&job);
+  }
+  for (long i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  fprintf(stderr, "%zu rows (%zu locations x %d days, %d levels) in %.3f s on %ld threads: %.0f rows/s\n",
+          rows, job.location_count, days, levels, seconds, started ? started : 1, rows / seconds);
+
+  if (output_path && !write_table(output_path, &job)) {
+    fprintf(stderr, "can't write %s\n", output_path);
+    return 1;
+  }
+  free(workers);
+  free(job.rows);
+  free((void *)job.locations);
+  return 0;
+}
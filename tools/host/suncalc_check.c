@@ -0,0 +1,296 @@
+/*
+ * Accuracy and speed check for calcSunRise/calcSunSet.
+ *
+ * Every (latitude, longitude, day) on a grid is compared against two
+ * double-precision references:
+ *
+ *  - NOAA: the NOAA solar calculator (Meeus' low-precision solar
+ *    coordinates plus the equation of time), iterated to the event time.
+ *    This measures how far the watch is from the real sky.
+ *  - almanac: the same Almanac algorithm calcSun uses, in double with
+ *    libm trig. This isolates what float and my_math cost, which is
+ *    what a speed optimization can make worse.
+ *
+ * Times are scored between the polar circles. Polar days and nights are
+ * checked everywhere: calcSun returns 0 for them, and so must agree with
+ * the double version of itself except right at the edge.
+ *
+ * calcSunEvents, the batched solver, must return exactly what calcSun does
+ * for each of the watch's zeniths.
+ *
+ * Exits 1 if any error is over budget, so `make check` can gate changes.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "suncalc.h"
+
+#define RAD (M_PI / 180.0)
+#define DEG (180.0 / M_PI)
+
+// budgets, in minutes. The NOAA ones are mostly the Almanac's own error.
+static double max_noaa_error = 5.0;
+static double mean_noaa_error = 1.0;
+static double max_almanac_error = 0.5;
+static double mean_almanac_error = 0.02;
+
+// |cos H| this close to 1 may round either way
+#define POLAR_EDGE 1e-3
+#define POLAR_CIRCLE 66
+
+static int year = 2025;
+static double zenith = ZENITH_OFFICIAL;
+
+/******************
+  REFERENCES
+*******************/
+static double julian_day(int y, int m, int d) {
+  if (m <= 2) { y -= 1; m += 12; }
+  int a = y / 100;
+  int b = 2 - a + a / 4;
+  return floor(365.25 * (y + 4716)) + floor(30.6001 * (m + 1)) + d + b - 1524.5;
+}
+
+// UT minutes of sunrise (or sunset) on the given date; NAN if there is none.
+static double noaa_event(int y, int m, int d, double lat, double lon, bool sunset) {
+  double jd0 = julian_day(y, m, d);
+  double minutes = 720 - 4 * lon;  // first guess: local noon
+  for (int i = 0; i < 3; i++) {
+    double T = (jd0 + minutes / 1440.0 - 2451545.0) / 36525.0;
+    double L0 = fmod(280.46646 + T * (36000.76983 + T * 0.0003032), 360.0);
+    double M = 357.52911 + T * (35999.05029 - 0.0001537 * T);
+    double e = 0.016708634 - T * (0.000042037 + 0.0000001267 * T);
+    double C = sin(M * RAD) * (1.914602 - T * (0.004817 + 0.000014 * T))
+             + sin(2 * M * RAD) * (0.019993 - 0.000101 * T)
+             + sin(3 * M * RAD) * 0.000289;
+    double omega = 125.04 - 1934.136 * T;
+    double lambda = L0 + C - 0.00569 - 0.00478 * sin(omega * RAD);
+    double eps0 = 23 + (26 + (21.448 - T * (46.815 + T * (0.00059 - T * 0.001813))) / 60) / 60;
+    double eps = eps0 + 0.00256 * cos(omega * RAD);
+    double decl = asin(sin(eps * RAD) * sin(lambda * RAD));
+    double yy = tan(eps * RAD / 2) * tan(eps * RAD / 2);
+    double eot = 4 * DEG * (yy * sin(2 * L0 * RAD) - 2 * e * sin(M * RAD)
+                            + 4 * e * yy * sin(M * RAD) * cos(2 * L0 * RAD)
+                            - 0.5 * yy * yy * sin(4 * L0 * RAD)
+                            - 1.25 * e * e * sin(2 * M * RAD));
+    double cos_h = cos(zenith * RAD) / (cos(lat * RAD) * cos(decl)) - tan(lat * RAD) * tan(decl);
+    if (cos_h > 1 || cos_h < -1) return NAN;
+    double h = acos(cos_h) * DEG;
+    minutes = 720 - 4 * (lon + (sunset ? -h : h)) - eot;
+  }
+  return minutes;
+}
+
+// calcSun, line for line, in double with libm. *cos_h_out gets the cosine
+// of the hour angle, which says how close the day is to polar.
+static double almanac_event(int y, int m, int d, double lat, double lon, bool sunset, double *cos_h_out) {
+  int N1 = 275 * m / 9;
+  int N2 = (m + 9) / 12;
+  int N3 = 1 + (y - 4 * (y / 4) + 2) / 3;
+  int N = N1 - N2 * N3 + d - 30;
+  double lng_hour = lon / 15;
+  double t = N + ((sunset ? 18 : 6) - lng_hour) / 24;
+  double M = 0.9856 * t - 3.289;
+  double L = fmod(M + 1.916 * sin(M * RAD) + 0.020 * sin(2 * M * RAD) + 282.634 + 360, 360);
+  double RA = fmod(atan(0.91764 * tan(L * RAD)) * DEG + 360, 360);
+  RA += floor(L / 90) * 90 - floor(RA / 90) * 90;
+  RA /= 15;
+  double sin_dec = 0.39782 * sin(L * RAD);
+  double cos_dec = cos(asin(sin_dec));
+  double cos_h = (cos(zenith * RAD) - sin_dec * sin(lat * RAD)) / (cos_dec * cos(lat * RAD));
+  *cos_h_out = cos_h;
+  if (cos_h > 1 || cos_h < -1) return NAN;
+  double H = (sunset ? acos(cos_h) * DEG : 360 - acos(cos_h) * DEG) / 15;
+  double UT = fmod(H + RA - 0.06571 * t - 6.622 - lng_hour + 48, 24);
+  return UT * 60;
+}
+
+/******************
+  GRID
+*******************/
+typedef struct {
+  double max;
+  double sum;
+  long count;
+  double max_lat, max_lon;
+  int max_yday;
+} ErrorStats;
+
+// signed difference of two times of day, in minutes, folded into +-12h.
+static double minutes_apart(double a, double b) {
+  double d = fmod(a - b, 1440);
+  if (d > 720) d -= 1440;
+  if (d < -720) d += 1440;
+  return fabs(d);
+}
+
+static void add_error(ErrorStats *stats, double error, double lat, double lon, int yday) {
+  stats->sum += error;
+  stats->count++;
+  if (error > stats->max) {
+    stats->max = error;
+    stats->max_lat = lat;
+    stats->max_lon = lon;
+    stats->max_yday = yday;
+  }
+}
+
+static void date_of(int yday, int *month, int *day) {
+  struct tm tm = { .tm_year = year - 1900, .tm_mon = 0, .tm_mday = 1 + yday, .tm_hour = 12 };
+  timegm(&tm);
+  *month = tm.tm_mon + 1;
+  *day = tm.tm_mday;
+}
+
+static bool report(const char *name, const ErrorStats *stats, double max_budget, double mean_budget) {
+  double mean = stats->count ? stats->sum / stats->count : 0;
+  bool ok = stats->max <= max_budget && mean <= mean_budget;
+  printf("%-8s max %6.3f min (lat %.0f lon %.0f day %d), mean %6.4f min  [budget %.3f / %.4f] %s\n",
+         name, stats->max, stats->max_lat, stats->max_lon, stats->max_yday + 1, mean,
+         max_budget, mean_budget, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s [--year Y] [--zenith Z] [--max-noaa MIN] [--mean-noaa MIN]\n"
+                  "       [--max-almanac MIN] [--mean-almanac MIN]\n", name);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--year") == 0 && has_value) year = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--zenith") == 0 && has_value) zenith = atof(argv[++i]);
+    else if (strcmp(argv[i], "--max-noaa") == 0 && has_value) max_noaa_error = atof(argv[++i]);
+    else if (strcmp(argv[i], "--mean-noaa") == 0 && has_value) mean_noaa_error = atof(argv[++i]);
+    else if (strcmp(argv[i], "--max-almanac") == 0 && has_value) max_almanac_error = atof(argv[++i]);
+    else if (strcmp(argv[i], "--mean-almanac") == 0 && has_value) mean_almanac_error = atof(argv[++i]);
+    else usage(argv[0]);
+  }
+
+  ErrorStats noaa = { 0 }, almanac = { 0 };
+  long polar_agree = 0, polar_disagree = 0, polar_edge = 0, unscored = 0;
+  long batch_mismatches = 0;
+  const float zeniths[SUNCALC_MAX_ZENITHS] = { zenith, ZENITH_CIVIL, ZENITH_NAUTICAL, ZENITH_ASTRONOMICAL };
+
+  // every day of the year, 2 degree latitude and 10 degree longitude
+  // steps, poles included: there cos(latitude) is 0.
+  for (int yday = 0; yday < 365; yday++) {
+    int month, day;
+    date_of(yday, &month, &day);
+    for (int lat = -90; lat <= 90; lat += 2) {
+      for (int lon = -180; lon < 180; lon += 10) {
+        SunEvents events;
+        calcSunEvents(year - 1900, month, day, lat, lon, zeniths, SUNCALC_MAX_ZENITHS, &events);
+        for (int z = 0; z < SUNCALC_MAX_ZENITHS; z++) {
+          float rise = calcSunRise(year - 1900, month, day, lat, lon, zeniths[z]);
+          float set = calcSunSet(year - 1900, month, day, lat, lon, zeniths[z]);
+          if (events.rise[z] != rise || events.set[z] != set ||
+              (events.polar[z] != SUNCALC_CROSSES) != (rise == 0 || set == 0)) {
+            batch_mismatches++;
+          }
+          // at a pole the sun circles at a constant height, so it never
+          // crosses any zenith; calcSun's 0 can't tell, the flag must.
+          if (abs(lat) == 90 && events.polar[z] == SUNCALC_CROSSES) {
+            polar_disagree++;
+          }
+        }
+
+        for (int sunset = 0; sunset <= 1; sunset++) {
+          // like the watch, pass tm_year
+          double watch = 60 * (sunset ? calcSunSet(year - 1900, month, day, lat, lon, zenith)
+                                      : calcSunRise(year - 1900, month, day, lat, lon, zenith));
+          double cos_h;
+          double alm = almanac_event(year - 1900, month, day, lat, lon, sunset, &cos_h);
+
+          if (isnan(alm) != (watch == 0)) {
+            // a polar day or night where the reference has an event, or
+            // the other way round. Fine right at the edge, where float
+            // rounding decides; a bug anywhere else.
+            if (fabs(cos_h) > 1 - POLAR_EDGE) polar_edge++;
+            else polar_disagree++;
+            continue;
+          }
+          if (isnan(alm)) {
+            polar_agree++;
+            continue;
+          }
+          // inside the polar circles the sun can skim the horizon for
+          // hours, and small errors in the declination become large
+          // errors in time; score the rest of the world.
+          if (abs(lat) > POLAR_CIRCLE) {
+            unscored++;
+            continue;
+          }
+          add_error(&almanac, minutes_apart(watch, alm), lat, lon, yday);
+
+          // the Almanac takes the declination at 6am/6pm rather than at
+          // the event, which costs it accuracy when the sun is up (or
+          // down) for only a couple of hours. Judge that against NOAA
+          // only on ordinary days.
+          double rise = noaa_event(year, month, day, lat, lon, false);
+          double set = noaa_event(year, month, day, lat, lon, true);
+          double day_length = fmod(set - rise + 2880, 1440);
+          if (isnan(rise) || isnan(set) || day_length < 120 || day_length > 1320) {
+            continue;
+          }
+          add_error(&noaa, minutes_apart(watch, sunset ? set : rise), lat, lon, yday);
+        }
+      }
+    }
+  }
+
+  // throughput over a smaller grid
+  long calls = 0;
+  volatile float sink = 0;
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int yday = 0; yday < 365; yday += 4) {
+    int month, day;
+    date_of(yday, &month, &day);
+    for (int lat = -60; lat <= 60; lat += 5) {
+      for (int lon = -180; lon < 180; lon += 30) {
+        sink += calcSunRise(year - 1900, month, day, lat, lon, zenith);
+        sink += calcSunSet(year - 1900, month, day, lat, lon, zenith);
+        calls += 2;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  // the same events, all four zeniths per call
+  long events_solved = 0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (int yday = 0; yday < 365; yday += 4) {
+    int month, day;
+    date_of(yday, &month, &day);
+    for (int lat = -60; lat <= 60; lat += 5) {
+      for (int lon = -180; lon < 180; lon += 30) {
+        SunEvents events;
+        calcSunEvents(year - 1900, month, day, lat, lon, zeniths, SUNCALC_MAX_ZENITHS, &events);
+        sink += events.rise[0] + events.set[SUNCALC_MAX_ZENITHS - 1];
+        events_solved += 2 * SUNCALC_MAX_ZENITHS;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double batch_seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  printf("%d, zenith %.2f, %ld events scored\n", year, zenith, almanac.count);
+  bool ok = report("NOAA", &noaa, max_noaa_error, mean_noaa_error);
+  ok = report("almanac", &almanac, max_almanac_error, mean_almanac_error) && ok;
+  printf("polar    %ld agree, %ld disagree, %ld on the edge; %ld events past %d degrees not scored\n",
+         polar_agree, polar_disagree, polar_edge, unscored, POLAR_CIRCLE);
+  if (polar_disagree) ok = false;
+  printf("batch    %ld mismatches against calcSun over %d zeniths %s\n", batch_mismatches,
+         SUNCALC_MAX_ZENITHS, batch_mismatches ? "FAIL" : "ok");
+  if (batch_mismatches) ok = false;
+  printf("speed    %.0f calls/s (%ld calls), batched %.0f events/s\n", calls / seconds, calls,
+         events_solved / batch_seconds);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Compiles tools/cities.txt into the watch's city table.
+
+Writes resources/data/cities.bin, which the watch looks cities up in by
+binary search (src/city_table.c), and the <option> list of the config
+page's city menu (between the "cities" markers in
+src/js/sunset-watch-config.html), so the two always agree on the ids.
+
+cities.bin, little-endian:
+
+    uint16 count
+    uint16 record size (12)
+    count records sorted by id:
+        uint16 id
+        int32  latitude, micro-degrees
+        int32  longitude, micro-degrees
+        int16  standard UTC offset, minutes
+
+Run it from anywhere after editing cities.txt, and commit the results.
+"""
+import os
+import re
+import struct
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "tools", "cities.txt")
+TABLE = os.path.join(ROOT, "resources", "data", "cities.bin")
+CONFIG = os.path.join(ROOT, "src", "js", "sunset-watch-config.html")
+
+# keep in sync with CITY_RECORD_SIZE in src/city_table.h
+RECORD = struct.Struct("<Hiih")
+
+
+def read_cities(path):
+    cities = []
+    for number, line in enumerate(open(path, encoding="utf-8"), 1):
+        line = line.strip()
+        if not line or line.startswith("#"):
+            continue
+        fields = line.split(None, 4)
+        if len(fields) != 5:
+            sys.exit("%s:%d: expected id, latitude, longitude, offset, name" % (path, number))
+        city_id, offset = int(fields[0]), int(fields[3])
+        latitude, longitude = float(fields[1]), float(fields[2])
+        if not 0 < city_id < 0x10000 or abs(latitude) > 90 or abs(longitude) > 180:
+            sys.exit("%s:%d: out of range" % (path, number))
+        cities.append((city_id, latitude, longitude, offset, fields[4]))
+
+    cities.sort()
+    for a, b in zip(cities, cities[1:]):
+        if a[0] == b[0]:
+            sys.exit("%s: id %d is used twice" % (path, a[0]))
+    return cities
+
+
+def write_table(cities, path):
+    data = struct.pack("<HH", len(cities), RECORD.size)
+    for city_id, latitude, longitude, offset, _ in cities:
+        data += RECORD.pack(city_id, round(latitude * 1000000), round(longitude * 1000000), offset)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def write_options(cities, path):
+    html = open(path, encoding="utf-8").read()
+    start, end = "<!-- cities: generated by tools/make_cities.py -->", "<!-- /cities -->"
+    match = re.search(r"([ \t]*)%s\n.*?%s" % (re.escape(start), re.escape(end)), html, re.S)
+    if not match:
+        sys.exit("%s: no city list markers" % path)
+    indent = match.group(1)
+    lines = [indent + start]
+    for city_id, _, _, _, name in sorted(cities, key=lambda city: city[4]):
+        lines.append('%s<option value="%d">%s</option>' % (indent, city_id, name))
+    lines.append(indent + end)
+    html = html[:match.start()] + "\n".join(lines) + html[match.end():]
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(html)
+
+
+def main():
+    cities = read_cities(SOURCE)
+    write_table(cities, TABLE)
+    write_options(cities, CONFIG)
+    print("%d cities, %d bytes" % (len(cities), os.path.getsize(TABLE)))
+
+
+if __name__ == "__main__":
+    main()